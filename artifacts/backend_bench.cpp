@@ -0,0 +1,243 @@
+/*
+ * backend_bench.cpp
+ *
+ * Compara todos los backends de inferencia compilados en el binario sobre
+ * el conjunto de test (data/processed/test.npz, ya normalizado):
+ * accuracy, acuerdo con la referencia TorchScript, latencia p50/p99 por
+ * predicción, coste por muestra en lote y memoria residente del modelo.
+ *
+ * Compile (con TorchScript como referencia):
+ *   make backend_bench
+ * Sin libtorch (solo backends nativos):
+ *   g++ -std=c++17 -O3 backend_bench.cpp -o backend_bench -lz
+ *
+ * Uso:
+ *   ./backend_bench --bundle bundle.conf --data ../data/processed/test.npz
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <getopt.h>
+
+#include "inference_backend.h"
+#include "backend_trees.h"
+#ifdef WITH_TORCH
+#include "backend_torchscript.h"
+#endif
+#include "npz_reader.h"
+
+#define DEFAULT_BUNDLE "./bundle.conf"
+#define DEFAULT_DATA "../data/processed/test.npz"
+#define REFERENCE_BACKEND "torchscript"
+
+// Clave del bundle con el modelo de cada backend
+static std::string model_key(const std::string& backend) {
+    return backend + "_model";
+}
+
+static long rss_kb() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct BenchResult {
+    std::string name;
+    std::string description;
+    bool loaded;
+    std::string error;
+    std::vector<int> preds;
+    double accuracy;
+    double agreement;      // -1 si no hay referencia
+    double p50_ns;
+    double p99_ns;
+    double batch_ns_per_sample;
+    long rss_delta_kb;
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    size_t k = (size_t)(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static BenchResult bench_backend(const std::string& name, const ModelBundle& bundle,
+                                 const NpyArray& X, const NpyArray& y, int repeat) {
+    BenchResult r = {};
+    r.name = name;
+    r.agreement = -1.0;
+
+    if (!bundle.has(model_key(name))) {
+        r.error = "bundle has no " + model_key(name);
+        return r;
+    }
+
+    long rss0 = rss_kb();
+    std::unique_ptr<InferenceBackend> backend = BackendRegistry::create(name);
+    if (!backend->load(bundle, &r.error)) return r;
+    backend->warm_up();
+    r.rss_delta_kb = rss_kb() - rss0;
+    r.loaded = true;
+    r.description = backend->describe();
+
+    int n = (int)X.rows(), nf = (int)X.cols();
+
+    // Accuracy con predict_batch
+    r.preds.resize(n);
+    backend->predict_batch(X.f32.data(), n, nf, r.preds.data());
+    int correct = 0;
+    for (int i = 0; i < n; i++) correct += (r.preds[i] == (int)y.i64[i]);
+    r.accuracy = n ? (double)correct / n : 0.0;
+
+    // Latencia de predicciones individuales (como las hace el daemon)
+    std::vector<double> lat;
+    lat.reserve((size_t)n * repeat);
+    for (int k = 0; k < repeat; k++) {
+        for (int i = 0; i < n; i++) {
+            auto t0 = std::chrono::steady_clock::now();
+            volatile int c = backend->predict(&X.f32[(size_t)i * nf]);
+            auto t1 = std::chrono::steady_clock::now();
+            (void)c;
+            lat.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+    }
+    r.p50_ns = percentile(lat, 0.50);
+    r.p99_ns = percentile(lat, 0.99);
+
+    // Coste amortizado en lote
+    std::vector<int> out(n);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k < repeat; k++) backend->predict_batch(X.f32.data(), n, nf, out.data());
+    auto t1 = std::chrono::steady_clock::now();
+    r.batch_ns_per_sample = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                            ((double)n * repeat);
+    return r;
+}
+
+static void print_results(const std::vector<BenchResult>& results, bool csv) {
+    if (csv) {
+        std::cout << "backend,accuracy,agreement,p50_ns,p99_ns,batch_ns_per_sample,rss_kb,description\n";
+        for (const auto& r : results) {
+            if (!r.loaded) continue;
+            std::cout << r.name << "," << r.accuracy << ","
+                      << (r.agreement < 0 ? std::string("") : std::to_string(r.agreement)) << ","
+                      << r.p50_ns << "," << r.p99_ns << "," << r.batch_ns_per_sample << ","
+                      << r.rss_delta_kb << ",\"" << r.description << "\"\n";
+        }
+        return;
+    }
+
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << std::left << std::setw(14) << "backend" << std::right
+              << std::setw(10) << "accuracy" << std::setw(11) << "agreement"
+              << std::setw(11) << "p50_ns" << std::setw(11) << "p99_ns"
+              << std::setw(13) << "batch_ns/s" << std::setw(10) << "rss_kb" << "\n";
+    for (const auto& r : results) {
+        if (!r.loaded) {
+            std::cout << std::left << std::setw(14) << r.name << std::right
+                      << "  (skipped: " << r.error << ")\n";
+            continue;
+        }
+        std::cout << std::left << std::setw(14) << r.name << std::right
+                  << std::setw(10) << r.accuracy;
+        if (r.agreement < 0) std::cout << std::setw(11) << "n/a";
+        else std::cout << std::setw(11) << r.agreement;
+        std::cout << std::setprecision(0)
+                  << std::setw(11) << r.p50_ns << std::setw(11) << r.p99_ns
+                  << std::setprecision(1) << std::setw(13) << r.batch_ns_per_sample
+                  << std::setw(10) << r.rss_delta_kb << std::setprecision(4) << "\n";
+        std::cout << "    " << r.description << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string bundle_path = DEFAULT_BUNDLE;
+    std::string data_path = DEFAULT_DATA;
+    int repeat = 100;
+    bool csv = false;
+
+    static struct option long_opts[] = {
+        {"bundle", required_argument, 0, 'b'},
+        {"data", required_argument, 0, 'd'},
+        {"repeat", required_argument, 0, 'n'},
+        {"csv", no_argument, 0, 'c'},
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:d:n:ch", long_opts, nullptr)) != -1) {
+        if (opt == 'b') bundle_path = optarg;
+        else if (opt == 'd') data_path = optarg;
+        else if (opt == 'n') repeat = std::max(1, atoi(optarg));
+        else if (opt == 'c') csv = true;
+        else if (opt == 'h') {
+            std::cout << "Usage: " << argv[0] << " [options]\n"
+                      << "  -b, --bundle <path>   Model bundle (default: ./bundle.conf)\n"
+                      << "  -d, --data <npz>      Normalized test set (default: " DEFAULT_DATA ")\n"
+                      << "  -n, --repeat <n>      Passes over the test set for timing (default: 100)\n"
+                      << "  -c, --csv             CSV output\n"
+                      << "  -h, --help            Show this help\n";
+            return 0;
+        }
+    }
+
+    ModelBundle bundle;
+    if (!bundle.open(bundle_path)) {
+        std::cerr << "ERROR: cannot open bundle " << bundle_path << "\n";
+        return 1;
+    }
+
+    NpyArray X, y;
+    try {
+        NpzReader npz;
+        npz.open(data_path);
+        X = npz.get("X");
+        y = npz.get("y");
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return 1;
+    }
+    if (X.f32.empty() || y.i64.size() != X.rows()) {
+        std::cerr << "ERROR: expected float X and integer y with matching rows\n";
+        return 1;
+    }
+    // Los backends leen NUM_FEATURES floats por fila (ver inference_backend.h)
+    if (X.cols() != NUM_FEATURES) {
+        std::cerr << "ERROR: X has " << X.cols() << " columns, backends expect " << NUM_FEATURES
+                  << " features\n";
+        return 1;
+    }
+
+    std::cerr << "Test set: " << X.rows() << " samples x " << X.cols() << " features\n";
+
+    std::vector<BenchResult> results;
+    for (const std::string& name : BackendRegistry::names())
+        results.push_back(bench_backend(name, bundle, X, y, repeat));
+
+    // Acuerdo con la referencia TorchScript (si está compilada y cargó)
+    const BenchResult* ref = nullptr;
+    for (const auto& r : results)
+        if (r.name == REFERENCE_BACKEND && r.loaded) ref = &r;
+    if (ref) {
+        for (auto& r : results) {
+            if (!r.loaded) continue;
+            int same = 0;
+            for (size_t i = 0; i < r.preds.size(); i++) same += (r.preds[i] == ref->preds[i]);
+            r.agreement = r.preds.empty() ? 0.0 : (double)same / r.preds.size();
+        }
+    }
+
+    print_results(results, csv);
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * backend_torchscript.h
+ *
+ * Backend "torchscript": el MLP exportado por train.py (model_ts.pt),
+ * ejecutado con libtorch. Es la referencia contra la que se comparan los
+ * demás backends.
+ */
+
+#pragma once
+
+#include <torch/script.h>
+#include <torch/torch.h>
+#include <vector>
+
+#include "inference_backend.h"
+
+class TorchScriptBackend : public InferenceBackend {
+private:
+    torch::jit::script::Module model;
+    std::string model_path;
+
+public:
+    bool load(const ModelBundle& bundle, std::string* err) override {
+        model_path = bundle.path_of("torchscript_model");
+        try {
+            model = torch::jit::load(model_path);
+            model.eval();  // Modo evaluación (desactiva dropout, etc.)
+        } catch (const c10::Error& e) {
+            if (err) *err = e.what();
+            return false;
+        }
+        return true;
+    }
+
+    int predict(const float* normalized) override {
+        int out = 0;
+        predict_batch(normalized, 1, 5, &out);
+        return out;
+    }
+
+    // Un solo forward para todo el lote
+    void predict_batch(const float* normalized, int n, int num_features, int* out) override {
+        std::vector<torch::jit::IValue> inputs;
+        auto options = torch::TensorOptions().dtype(torch::kFloat32);
+        torch::Tensor input_tensor = torch::from_blob(
+            const_cast<float*>(normalized),
+            {n, num_features},
+            options
+        ).clone();  // Clone para evitar problemas de memoria
+
+        inputs.push_back(input_tensor);
+
+        torch::Tensor output;
+        {
+            torch::NoGradGuard no_grad;  // Desactivar cálculo de gradientes
+            output = model.forward(inputs).toTensor();
+        }
+
+        torch::Tensor classes = output.argmax(1).contiguous();
+        const int64_t* c = classes.data_ptr<int64_t>();
+        for (int i = 0; i < n; i++) out[i] = (int)c[i];
+    }
+
+    std::string describe() const override {
+        return "torchscript (" + model_path + ")";
+    }
+};
+
+REGISTER_INFERENCE_BACKEND("torchscript", TorchScriptBackend);
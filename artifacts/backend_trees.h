@@ -0,0 +1,55 @@
+/*
+ * backend_trees.h
+ *
+ * Backend "trees": ensemble de árboles plano (ver tree_ensemble.h).
+ * No depende de libtorch.
+ */
+
+#pragma once
+
+#include <sstream>
+
+#include "inference_backend.h"
+#include "tree_ensemble.h"
+
+class TreeEnsembleBackend : public InferenceBackend {
+private:
+    TreeEnsemble trees;
+
+public:
+    bool load(const ModelBundle& bundle, std::string* err) override {
+        try {
+            trees.load(bundle.path_of("trees_model"));
+        } catch (const std::exception& e) {
+            if (err) *err = e.what();
+            return false;
+        }
+        // El daemon pasa siempre NUM_FEATURES características y espera una de
+        // las 3 clases (sequential/random/mixed): otra forma se lee fuera del
+        // vector o devuelve clases sin nombre
+        if (trees.get_num_features() != NUM_FEATURES || trees.get_num_classes() != 3) {
+            if (err) {
+                std::ostringstream oss;
+                oss << "tree ensemble has " << trees.get_num_features() << " features and "
+                    << trees.get_num_classes() << " classes, expected " << NUM_FEATURES
+                    << " and 3";
+                *err = oss.str();
+            }
+            return false;
+        }
+        return true;
+    }
+
+    int predict(const float* normalized) override {
+        return trees.predict(normalized);
+    }
+
+    std::string describe() const override {
+        std::ostringstream oss;
+        oss << "trees (" << trees.get_num_trees() << " árboles, profundidad "
+            << trees.get_depth() << ", " << TREE_LANES << " lanes)";
+        return oss.str();
+    }
+};
+
+REGISTER_INFERENCE_BACKEND("trees", TreeEnsembleBackend);
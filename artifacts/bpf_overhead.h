@@ -0,0 +1,168 @@
+/*
+ * bpf_overhead.h
+ *
+ * Coste del propio colector: tiempo de ejecución de cada programa BPF
+ * (run_cnt / run_time_ns de bpf_prog_info) y CPU del proceso en espacio de
+ * usuario, por ventana.
+ *
+ * El kernel solo mide el tiempo de los programas con las estadísticas
+ * activadas: BPF_ENABLE_STATS (Linux 5.8+) las mantiene mientras el fd
+ * devuelto siga abierto; en kernels anteriores se usa el sysctl
+ * kernel.bpf_stats_enabled y se restaura al terminar. run_time_ns incluye
+ * lo que tarda el programa en cada disparo del tracepoint o kprobe, es
+ * decir, la latencia que el trazador añade a cada I/O en esa CPU.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <linux/bpf.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#define BPF_STATS_SYSCTL "/proc/sys/kernel/bpf_stats_enabled"
+
+struct ProgRunStats {
+    uint64_t run_cnt;
+    uint64_t run_time_ns;
+};
+
+// run_cnt y run_time_ns acumulados de un programa cargado
+static inline bool bpf_prog_run_stats(int prog_fd, ProgRunStats* out) {
+    struct bpf_prog_info info;
+    memset(&info, 0, sizeof(info));
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.info.bpf_fd = (uint32_t)prog_fd;
+    attr.info.info_len = sizeof(info);
+    attr.info.info = (uint64_t)(uintptr_t)&info;
+    if (syscall(__NR_bpf, BPF_OBJ_GET_INFO_BY_FD, &attr, sizeof(attr)) != 0) return false;
+    out->run_cnt = info.run_cnt;
+    out->run_time_ns = info.run_time_ns;
+    return true;
+}
+
+// CPU (usuario + sistema) consumida por todo el proceso, en ns
+static inline uint64_t process_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+struct ProgramCost {
+    std::string name;
+    uint64_t runs;          // disparos en la ventana
+    uint64_t run_ns;        // tiempo total en la ventana
+    double ns_per_run() const { return runs ? (double)run_ns / runs : 0.0; }
+};
+
+struct OverheadWindow {
+    std::vector<ProgramCost> programs;
+    uint64_t bpf_ns;        // suma de todos los programas
+    uint64_t cpu_ns;        // CPU del proceso colector
+    double wall_s;          // duración real de la ventana
+};
+
+class BpfOverheadMonitor {
+private:
+    struct Program {
+        std::string name;
+        int fd;
+        ProgRunStats prev;
+    };
+
+    std::vector<Program> programs;
+    int stats_fd;                 // fd de BPF_ENABLE_STATS (-1 si no)
+    int sysctl_prev;              // valor previo del sysctl si se cambió (-1 si no)
+    uint64_t prev_cpu_ns;
+    struct timespec prev_wall;
+
+    static int read_sysctl() {
+        std::ifstream in(BPF_STATS_SYSCTL);
+        int v = -1;
+        in >> v;
+        return v;
+    }
+
+    static bool write_sysctl(int v) {
+        std::ofstream out(BPF_STATS_SYSCTL);
+        if (!out.is_open()) return false;
+        out << v << std::endl;
+        return out.good();
+    }
+
+public:
+    BpfOverheadMonitor() : stats_fd(-1), sysctl_prev(-1), prev_cpu_ns(0), prev_wall() {}
+
+    ~BpfOverheadMonitor() {
+        if (stats_fd >= 0) close(stats_fd);
+        if (sysctl_prev >= 0) write_sysctl(sysctl_prev);
+    }
+
+    /**
+     * Activa la medida de tiempo de los programas BPF. Devuelve una
+     * descripción del mecanismo usado o "" si no se pudo.
+     */
+    std::string enable() {
+        union bpf_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.enable_stats.type = BPF_STATS_RUN_TIME;
+        long fd = syscall(__NR_bpf, BPF_ENABLE_STATS, &attr, sizeof(attr));
+        if (fd >= 0) {
+            stats_fd = (int)fd;
+            return "BPF_ENABLE_STATS";
+        }
+        int cur = read_sysctl();
+        if (cur == 1) return "kernel.bpf_stats_enabled (already on)";
+        if (cur == 0 && write_sysctl(1)) {
+            sysctl_prev = 0;
+            return "kernel.bpf_stats_enabled";
+        }
+        return "";
+    }
+
+    // Registra un programa ya cargado; la primera muestra sirve de referencia
+    void add_program(const std::string& name, int fd) {
+        Program p = {name, fd, {0, 0}};
+        bpf_prog_run_stats(fd, &p.prev);
+        programs.push_back(p);
+    }
+
+    size_t size() const { return programs.size(); }
+
+    // Marca el inicio de la primera ventana
+    void start() {
+        prev_cpu_ns = process_cpu_ns();
+        clock_gettime(CLOCK_MONOTONIC, &prev_wall);
+    }
+
+    // Coste desde la llamada anterior
+    OverheadWindow sample() {
+        OverheadWindow w = {{}, 0, 0, 0.0};
+        for (Program& p : programs) {
+            ProgRunStats now;
+            if (!bpf_prog_run_stats(p.fd, &now)) continue;
+            ProgramCost c = {p.name, now.run_cnt - p.prev.run_cnt,
+                             now.run_time_ns - p.prev.run_time_ns};
+            p.prev = now;
+            w.bpf_ns += c.run_ns;
+            w.programs.push_back(c);
+        }
+        uint64_t cpu = process_cpu_ns();
+        w.cpu_ns = cpu - prev_cpu_ns;
+        prev_cpu_ns = cpu;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        w.wall_s = (double)(now.tv_sec - prev_wall.tv_sec) +
+                   (double)(now.tv_nsec - prev_wall.tv_nsec) / 1e9;
+        prev_wall = now;
+        return w;
+    }
+};
@@ -0,0 +1,153 @@
+/*
+ * collector_config.h
+ *
+ * Configuración del colector por clase de dispositivo (hdd, ssd, nvme).
+ *
+ * Formato INI sencillo; lo escribe window_tuner y lo lee ebpf_block_trace:
+ *
+ *   [ssd]
+ *   window_ms = 1000
+ *   jump_threshold_bytes = 1000000
+ *
+ * La sección [default] se usa cuando no hay sección para la clase detectada.
+ * save() reescribe el archivo tal como se leyó (comentarios, claves que no
+ * se tocan, orden) cambiando solo las claves puestas con set().
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+
+#define DEFAULT_CONFIG_PATH "/etc/ebpf_block_trace.conf"
+
+class CollectorConfig {
+private:
+    // Línea del archivo: comentario/vacía (key ""), cabecera de sección o clave
+    struct Line {
+        std::string text;
+        std::string section;
+        std::string key;
+        bool header;
+    };
+
+    std::map<std::string, std::map<std::string, std::string>> sections;
+    std::vector<Line> lines;
+
+    static std::string trim(const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos) return "";
+        size_t e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+    }
+
+public:
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) return false;
+        std::string raw, section = "default";
+        while (std::getline(in, raw)) {
+            std::string line = trim(raw);
+            if (line.empty() || line[0] == '#' || line[0] == ';') {
+                lines.push_back({raw, section, "", false});
+                continue;
+            }
+            if (line[0] == '[' && line.back() == ']') {
+                section = trim(line.substr(1, line.size() - 2));
+                lines.push_back({raw, section, "", true});
+                continue;
+            }
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                lines.push_back({raw, section, "", false});
+                continue;
+            }
+            std::string key = trim(line.substr(0, eq));
+            sections[section][key] = trim(line.substr(eq + 1));
+            lines.push_back({raw, section, key, false});
+        }
+        return true;
+    }
+
+    /**
+     * Escribe las líneas leídas con las claves de set() actualizadas en su
+     * sitio; header se añade como comentario si el archivo no lo tiene ya.
+     */
+    bool save(const std::string& path, const std::string& header = "") const {
+        std::ofstream out(path);
+        if (!out.is_open()) return false;
+        bool has_header = header.empty();
+        for (const Line& l : lines)
+            if (l.text == "# " + header) has_header = true;
+        if (!has_header) out << "# " << header << "\n";
+        for (const Line& l : lines) out << l.text << "\n";
+        return out.good();
+    }
+
+    bool has(const std::string& section, const std::string& key) const {
+        auto it = sections.find(section);
+        return it != sections.end() && it->second.count(key);
+    }
+
+    // Busca en la sección y, si no está, en [default]
+    std::string get(const std::string& section, const std::string& key,
+                    const std::string& def = "") const {
+        if (has(section, key)) return sections.at(section).at(key);
+        if (has("default", key)) return sections.at("default").at(key);
+        return def;
+    }
+
+    long long get_int(const std::string& section, const std::string& key, long long def) const {
+        std::string v = get(section, key);
+        return v.empty() ? def : atoll(v.c_str());
+    }
+
+    // Actualiza la línea de la clave o la añade al final de su sección
+    void set(const std::string& section, const std::string& key, const std::string& value) {
+        sections[section][key] = value;
+        std::string text = key + " = " + value;
+        size_t last = lines.size();
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (lines[i].section != section) continue;
+            if (lines[i].key == key) {
+                lines[i].text = text;
+                return;
+            }
+            if (lines[i].header || !lines[i].key.empty()) last = i;
+        }
+        if (last == lines.size()) {
+            if (!lines.empty()) lines.push_back({"", section, "", false});
+            lines.push_back({"[" + section + "]", section, "", true});
+            last = lines.size() - 1;
+        }
+        lines.insert(lines.begin() + last + 1, Line{text, section, key, false});
+    }
+};
+
+/**
+ * Clasifica un dispositivo de bloque en "nvme", "ssd" o "hdd" según sysfs.
+ * Acepta particiones (sda2 -> sda).
+ */
+static inline std::string detect_device_class(const std::string& dev) {
+    std::string disk = dev;
+    char buf[PATH_MAX];
+    std::string link = "/sys/class/block/" + dev;
+    if (access((link + "/partition").c_str(), F_OK) == 0 && realpath(link.c_str(), buf)) {
+        std::string p(buf);
+        p = p.substr(0, p.rfind('/'));
+        disk = p.substr(p.rfind('/') + 1);
+    }
+
+    if (disk.compare(0, 4, "nvme") == 0) return "nvme";
+
+    std::ifstream rot("/sys/block/" + disk + "/queue/rotational");
+    int r = 0;
+    if (rot.is_open() && (rot >> r) && r == 1) return "hdd";
+    return "ssd";
+}
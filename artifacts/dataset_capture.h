@@ -0,0 +1,194 @@
+/*
+ * dataset_capture.h
+ *
+ * Captura etiquetada del colector: una fila por ventana con el mismo
+ * esquema que data/consolidated_dataset.csv (consolidateV2.py), que lee
+ * red_neuronal/build_dataset_from_consolidated.py, sin pasar por trazas de
+ * LTTng en texto.
+ *
+ * Las columnas trace_* salen de las características de la ventana tal como
+ * las calcula el colector en producción; iops_mean es la tasa de I/O de la
+ * ventana (el consolidado de LTTng la tomaba de fio) y las columnas de las
+ * características (FEATURE_NAMES) se añaden al final tal cual. Las columnas
+ * de fio que no aplican (latencias, parámetros del job) quedan vacías.
+ *
+ * Tras ellas van la residencia en caché de los archivos más leídos
+ * (cached_fraction, recently_evicted_pages; vacías sin --hot-files): no
+ * entran en el vector del modelo, que tiene NUM_FEATURES fijas en el
+ * protocolo, pero quedan en el dataset para entrenar con ellas.
+ *
+ * La etiqueta es fija (--label) o la fija el generador de carga por un
+ * socket Unix de datagramas (io_workload --label-socket):
+ *
+ *   "label <clase>"   etiqueta de las ventanas siguientes ("label" sola = sin etiqueta)
+ *   "run <id>"        run_id de las filas siguientes
+ *
+ * Una ventana durante la que cambió la etiqueta se descarta: mezcla dos
+ * fases. Las ventanas sin etiqueta tampoco se escriben.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "window_features.h"
+
+#define LABEL_MSG_MAX 256
+
+// Columnas de consolidated_dataset.csv; las de fio sin equivalente quedan vacías
+static const char* const CAPTURE_COLUMNS =
+    "run_id,pattern,mode,window_id,timestamp_start,timestamp_end,trace_total_events,"
+    "trace_block_rq_issue,trace_block_rq_complete,trace_block_rq_insert,"
+    "trace_avg_sector_distance,trace_sector_jump_ratio,trace_unique_sectors,"
+    "trace_avg_request_size_kb,bw_mean_kbps,bw_std_kbps,bw_min_kbps,bw_max_kbps,lat_mean_ns,"
+    "lat_std_ns,lat_p95_ns,iops_mean,iops_std,run_total_io_mb,run_avg_bw_kbps,run_avg_iops,"
+    "run_avg_lat_ns,run_lat_stddev_ns,run_lat_p99_ns,run_usr_cpu,run_sys_cpu,bs,iodepth,"
+    "numjobs,direct,cpu_cores,mem_free_mb,label";
+
+struct CaptureRow {
+    std::string run_id;
+    std::string label;
+    uint64_t window_id;
+    double t_start_s;          // desde el inicio de la captura
+    double t_end_s;
+    uint64_t start_ns;         // CLOCK_MONOTONIC (reloj de --record y de io_workload)
+    uint64_t events;           // eventos recibidos (issue + complete)
+    uint64_t issued;
+    uint64_t completed;
+    double unique_sectors;     // estimación HLL; -1 si no se mide
+    const WindowAggregate* agg;
+    const float* f;            // características de la ventana (FEATURE_NAMES)
+    double window_s;
+    double cached_fraction;    // residencia del top-K (file_residency.h); -1 si no se mide
+    double recently_evicted;   // páginas; -1 si no se mide
+};
+
+class DatasetWriter {
+private:
+    FILE* fp;
+
+public:
+    DatasetWriter() : fp(nullptr) {}
+
+    ~DatasetWriter() {
+        if (fp) fclose(fp);
+    }
+
+    // Abre en modo append; la cabecera solo si el archivo está vacío
+    bool open(const std::string& path) {
+        fp = fopen(path.c_str(), "a");
+        if (!fp) return false;
+        struct stat st;
+        if (fstat(fileno(fp), &st) == 0 && st.st_size == 0) {
+            fprintf(fp, "%s,window_ms,ts_start_ns", CAPTURE_COLUMNS);
+            for (int i = 0; i < NUM_FEATURES; i++) fprintf(fp, ",%s", FEATURE_NAMES[i]);
+            fprintf(fp, ",cached_fraction,recently_evicted_pages\n");
+        }
+        return true;
+    }
+
+    void write(const CaptureRow& r) {
+        const float* f = r.f;
+        double bw_kbps = r.window_s > 0 ? (double)r.agg->bytes_acc / 1024.0 / r.window_s : 0.0;
+        fprintf(fp, "%s,%s,ebpf,%llu,%.3f,%.3f,%llu,%llu,%llu,,%.2f,%.4f,",
+                r.run_id.c_str(), r.label.c_str(), (unsigned long long)r.window_id,
+                r.t_start_s, r.t_end_s, (unsigned long long)r.events,
+                (unsigned long long)r.issued, (unsigned long long)r.completed,
+                f[0] / 512.0, f[1]);
+        if (r.unique_sectors >= 0) fprintf(fp, "%.0f", r.unique_sectors);
+        fprintf(fp, ",%.2f,%.2f,,,,,,,%.2f,,,,,,,,,,,,,,,,%s,%.0f,%llu",
+                f[2] / 1024.0, bw_kbps, f[4], r.label.c_str(), r.window_s * 1000.0,
+                (unsigned long long)r.start_ns);
+        for (int i = 0; i < NUM_FEATURES; i++) fprintf(fp, ",%.4f", f[i]);
+        fprintf(fp, ",");
+        if (r.cached_fraction >= 0) fprintf(fp, "%.4f", r.cached_fraction);
+        fprintf(fp, ",");
+        if (r.recently_evicted >= 0) fprintf(fp, "%.0f", r.recently_evicted);
+        fprintf(fp, "\n");
+        fflush(fp);
+    }
+};
+
+class LabelControl {
+private:
+    int fd;
+    std::string path;
+    std::string label;
+    std::string run_id;
+    bool changed;              // mensajes de etiqueta desde la última ventana
+
+public:
+    LabelControl() : fd(-1), changed(false) {}
+
+    ~LabelControl() {
+        if (fd >= 0) {
+            close(fd);
+            unlink(path.c_str());
+        }
+    }
+
+    // Etiqueta fija, sin socket
+    void set(const std::string& l, const std::string& run) {
+        label = l;
+        run_id = run;
+    }
+
+    bool listen(const std::string& sock_path) {
+        fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(sock_path.c_str());
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        path = sock_path;
+        return true;
+    }
+
+    // Lee los mensajes pendientes (no bloquea)
+    void poll() {
+        if (fd < 0) return;
+        char buf[LABEL_MSG_MAX];
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf) - 1, 0)) > 0) {
+            buf[n] = '\0';
+            std::string msg(buf);
+            while (!msg.empty() && (msg.back() == '\n' || msg.back() == ' ')) msg.pop_back();
+            if (msg.compare(0, 5, "label") == 0) {
+                std::string l = msg.size() > 6 ? msg.substr(6) : "";
+                if (l != label) changed = true;
+                label = l;
+            } else if (msg.compare(0, 4, "run ") == 0) {
+                run_id = msg.substr(4);
+                changed = true;
+            }
+        }
+    }
+
+    /**
+     * Etiqueta utilizable para la ventana que acaba de cerrarse, o "" si no
+     * hay o cambió durante la ventana.
+     */
+    std::string window_label() {
+        poll();
+        bool was_changed = changed;
+        changed = false;
+        return was_changed ? "" : label;
+    }
+
+    const std::string& current_label() const { return label; }
+    const std::string& current_run() const { return run_id; }
+};
@@ -0,0 +1,120 @@
+/*
+ * device_stack.h
+ *
+ * Pila de dispositivos de bloque (dm-crypt, LVM, md RAID, multipath) a
+ * partir de sysfs.
+ *
+ * Con dispositivos apilados block_rq_* se dispara en los discos miembro con
+ * sectores relativos a cada miembro: un RAID secuencial parece aleatorio en
+ * cada disco. El colector observa entonces el dispositivo superior a nivel
+ * de bio (block_bio_queue / block_bio_complete, sectores del dispositivo
+ * superior) y descarta las peticiones de los miembros. El read_ahead_kb que
+ * usa la caché de páginas es el del dispositivo superior.
+ *
+ *   /sys/class/block/<dev>/holders/   dispositivos construidos encima
+ *   /sys/class/block/<dev>/slaves/    dispositivos que hay debajo
+ */
+
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define STACK_MAX_DEPTH 8        // niveles de holders/slaves que se recorren
+#define STACK_MAX_MEMBERS 64     // entradas del mapa stack_members en BPF
+
+struct DeviceStack {
+    std::string device;              // el pedido (p.ej. sda2 o dm-0)
+    std::string top;                 // dispositivo superior de la pila
+    uint32_t top_dev;                // dev_t de top (MKDEV del kernel)
+    std::string queue_disk;          // disco cuya cola tiene read_ahead_kb
+    std::vector<std::string> members;     // dispositivos por debajo de top
+    std::vector<uint32_t> member_devs;    // sus dev_t y los de sus discos padre
+
+    // true si top tiene dispositivos debajo (dm, md): se observa a nivel de bio
+    bool stacked() const { return !members.empty(); }
+
+    std::string readahead_path() const {
+        return "/sys/block/" + queue_disk + "/queue/read_ahead_kb";
+    }
+};
+
+// Entradas de un directorio de sysfs (sin . ni ..)
+static inline std::vector<std::string> sysfs_list(const std::string& dir) {
+    std::vector<std::string> out;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return out;
+    struct dirent* de;
+    while ((de = readdir(d)) != nullptr) {
+        if (de->d_name[0] == '.') continue;
+        out.push_back(de->d_name);
+    }
+    closedir(d);
+    return out;
+}
+
+// dev_t de /sys/class/block/<dev>/dev ("maj:min") como MKDEV del kernel; 0 si no existe
+static inline uint32_t sysfs_block_devt(const std::string& dev) {
+    std::ifstream in("/sys/class/block/" + dev + "/dev");
+    unsigned major = 0, minor = 0;
+    char colon = 0;
+    if (!(in >> major >> colon >> minor) || colon != ':') return 0;
+    return (major << 20) | minor;
+}
+
+// Disco que contiene una partición (sda2 -> sda); el propio nombre si no lo es
+static inline std::string sysfs_parent_disk(const std::string& dev) {
+    std::string link = "/sys/class/block/" + dev;
+    char buf[PATH_MAX];
+    if (access((link + "/partition").c_str(), F_OK) != 0 || !realpath(link.c_str(), buf))
+        return dev;
+    std::string p(buf);
+    p = p.substr(0, p.rfind('/'));
+    return p.substr(p.rfind('/') + 1);
+}
+
+/**
+ * Sube por holders hasta el dispositivo superior y recoge todo lo que hay
+ * debajo por slaves. Con varios holders (p.ej. dos LV sobre el mismo PV) no
+ * hay un único dispositivo superior: se queda en el pedido.
+ */
+static inline DeviceStack build_device_stack(const std::string& dev) {
+    DeviceStack s;
+    s.device = dev;
+    s.top = dev;
+    for (int depth = 0; depth < STACK_MAX_DEPTH; depth++) {
+        std::vector<std::string> holders = sysfs_list("/sys/class/block/" + s.top + "/holders");
+        if (holders.size() != 1) break;
+        s.top = holders[0];
+    }
+    s.top_dev = sysfs_block_devt(s.top);
+    s.queue_disk = sysfs_parent_disk(s.top);
+
+    std::vector<std::string> frontier = {s.top};
+    for (int depth = 0; depth < STACK_MAX_DEPTH && !frontier.empty(); depth++) {
+        std::vector<std::string> next;
+        for (const std::string& d : frontier) {
+            for (const std::string& m : sysfs_list("/sys/class/block/" + d + "/slaves")) {
+                s.members.push_back(m);
+                next.push_back(m);
+            }
+        }
+        frontier.swap(next);
+    }
+
+    // block_rq_* informa del disco, no de la partición: se añaden ambos
+    for (const std::string& m : s.members) {
+        uint32_t id = sysfs_block_devt(m);
+        if (id) s.member_devs.push_back(id);
+        std::string disk = sysfs_parent_disk(m);
+        if (disk != m && (id = sysfs_block_devt(disk)) != 0) s.member_devs.push_back(id);
+    }
+    if (s.member_devs.size() > STACK_MAX_MEMBERS) s.member_devs.resize(STACK_MAX_MEMBERS);
+    return s;
+}
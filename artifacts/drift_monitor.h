@@ -0,0 +1,183 @@
+/*
+ * drift_monitor.h
+ *
+ * Detección online de drift de características en el daemon ml_predictor.
+ *
+ * build_dataset_from_consolidated.py guarda en el bundle, para cada
+ * característica i (valores SIN normalizar del conjunto de entrenamiento):
+ *
+ *   drift_edges_<i> = cuantiles 0%,10%,...,100% sin repetidos (e_0 < ... < e_k)
+ *   drift_ref_<i>   = fracción de entrenamiento en cada uno de los k+2 bins:
+ *                     x <= e_0, (e_0, e_1], ..., (e_k-1, e_k], x > e_k
+ *
+ * (mismo criterio que np.searchsorted(edges, x, side="left")). Por cada
+ * dispositivo se mantiene un histograma con decaimiento exponencial de los
+ * valores recibidos sobre esos mismos bins y se compara con la referencia:
+ *
+ *   PSI = sum (p_live - p_ref) * ln(p_live / p_ref)
+ *   KS  = max |CDF_live - CDF_ref|
+ *
+ * PSI/KS miden cuánto se aleja el dispositivo de la mezcla de entrenamiento
+ * y se exportan como puntuación de drift; una carga homogénea (una sola
+ * clase) ya da PSI alto, así que no deciden por sí solos. Una ventana se
+ * marca fuera de distribución (OOD) si alguna característica vigilada queda
+ * fuera del soporte de entrenamiento [e_0, e_k], con una holgura de
+ * DRIFT_RANGE_MARGIN veces el decil exterior de cada lado.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "model_bundle.h"
+
+#define DRIFT_DECAY         0.98    // ~50 ventanas de memoria efectiva
+#define DRIFT_MIN_WEIGHT    20.0    // peso mínimo antes de calcular PSI/KS
+#define DRIFT_PSI_HIGH      0.25    // cambio significativo
+#define DRIFT_EPS           1e-4    // suavizado de bins vacíos en el PSI
+#define DRIFT_RANGE_MARGIN  0.50    // holgura sobre el soporte de entrenamiento
+
+struct DriftResult {
+    bool warmed;            // hay suficiente historia para PSI/KS
+    double psi_max;
+    double ks_max;
+    int worst_feature;      // característica con mayor PSI (-1 si ninguna)
+    int out_of_range;       // características vigiladas fuera del rango de entrenamiento
+    bool drift;             // psi_max > DRIFT_PSI_HIGH
+    bool ood;               // out_of_range > 0
+};
+
+class DriftMonitor {
+private:
+    struct FeatureReference {
+        bool watched;
+        std::vector<float> edges;
+        std::vector<double> ref;      // edges.size() + 1 bins
+        float lo, hi;                 // rango aceptado (con margen)
+    };
+
+    struct DeviceState {
+        std::vector<std::vector<double>> counts;
+        double weight;
+        uint64_t samples;
+        DriftResult last;
+    };
+
+    std::vector<FeatureReference> refs;
+    std::map<uint32_t, DeviceState> devices;
+
+    static int bin_of(const FeatureReference& r, float x) {
+        return (int)(std::lower_bound(r.edges.begin(), r.edges.end(), x) - r.edges.begin());
+    }
+
+    static void scores(const FeatureReference& r, const std::vector<double>& counts,
+                       double weight, double* psi, double* ks) {
+        double p = 0.0, cdf_live = 0.0, cdf_ref = 0.0;
+        *ks = 0.0;
+        for (size_t b = 0; b < r.ref.size(); b++) {
+            double live = counts[b] / weight;
+            double ref = r.ref[b];
+            p += (live - ref) * std::log((live + DRIFT_EPS) / (ref + DRIFT_EPS));
+            cdf_live += live;
+            cdf_ref += ref;
+            *ks = std::max(*ks, std::fabs(cdf_live - cdf_ref));
+        }
+        *psi = p;
+    }
+
+public:
+    /**
+     * Carga la referencia del bundle. Las características con std == 0 en
+     * entrenamiento (normalizadas siempre a 0) no se vigilan: el modelo no
+     * puede verlas. La clave opcional drift_features restringe la lista.
+     *
+     * @return false si el bundle no trae referencia (monitor desactivado)
+     */
+    bool load(const ModelBundle& bundle, int num_features, const float* stds) {
+        refs.clear();
+        devices.clear();
+
+        std::vector<float> watched_list = bundle.get_floats("drift_features");
+        for (int i = 0; i < num_features; i++) {
+            FeatureReference r;
+            r.edges = bundle.get_floats("drift_edges_" + std::to_string(i));
+            std::vector<float> ref = bundle.get_floats("drift_ref_" + std::to_string(i));
+            if (r.edges.empty() || ref.size() != r.edges.size() + 1) {
+                refs.clear();
+                return false;
+            }
+            r.ref.assign(ref.begin(), ref.end());
+            size_t k = r.edges.size() - 1;
+            r.lo = r.edges[0] - (k ? DRIFT_RANGE_MARGIN * (r.edges[1] - r.edges[0]) : 0.0f);
+            r.hi = r.edges[k] + (k ? DRIFT_RANGE_MARGIN * (r.edges[k] - r.edges[k - 1]) : 0.0f);
+            r.watched = stds[i] > 0.0001f;
+            if (!watched_list.empty())
+                r.watched = r.watched &&
+                    std::find(watched_list.begin(), watched_list.end(), (float)i) != watched_list.end();
+            refs.push_back(r);
+        }
+        return true;
+    }
+
+    bool enabled() const { return !refs.empty(); }
+
+    bool watched(int feature) const { return refs[feature].watched; }
+
+    /**
+     * Añade un vector sin normalizar a la historia del dispositivo y
+     * devuelve su estado de drift.
+     */
+    DriftResult observe(uint32_t device_id, const float* raw) {
+        DriftResult res = {};
+        res.worst_feature = -1;
+        if (refs.empty()) return res;
+
+        DeviceState& st = devices[device_id];
+        if (st.counts.empty()) {
+            st.counts.resize(refs.size());
+            for (size_t i = 0; i < refs.size(); i++) st.counts[i].assign(refs[i].ref.size(), 0.0);
+            st.weight = 0.0;
+            st.samples = 0;
+        }
+
+        st.weight = st.weight * DRIFT_DECAY + 1.0;
+        st.samples++;
+        res.warmed = st.weight >= DRIFT_MIN_WEIGHT;
+
+        for (size_t i = 0; i < refs.size(); i++) {
+            const FeatureReference& r = refs[i];
+            int b = bin_of(r, raw[i]);
+            for (double& c : st.counts[i]) c *= DRIFT_DECAY;
+            st.counts[i][b] += 1.0;
+
+            if (!r.watched) continue;
+            if (raw[i] < r.lo || raw[i] > r.hi) res.out_of_range++;
+            if (res.warmed) {
+                double psi, ks;
+                scores(r, st.counts[i], st.weight, &psi, &ks);
+                if (res.worst_feature < 0 || psi > res.psi_max) {
+                    res.psi_max = psi;
+                    res.worst_feature = (int)i;
+                }
+                res.ks_max = std::max(res.ks_max, ks);
+            }
+        }
+
+        res.drift = res.psi_max > DRIFT_PSI_HIGH;
+        res.ood = res.out_of_range > 0;
+        st.last = res;
+        return res;
+    }
+
+    // Último estado de cada dispositivo (para los logs del daemon)
+    std::map<uint32_t, DriftResult> snapshot() const {
+        std::map<uint32_t, DriftResult> out;
+        for (const auto& kv : devices) out[kv.first] = kv.second.last;
+        return out;
+    }
+};
@@ -5,7 +5,6 @@
 
 #include <iostream>
 #include <vector>
-#include <deque>
 #include <chrono>
 #include <thread>
 #include <cstring>
@@ -14,8 +13,8 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
-#include <sys/socket.h>
-#include <sys/un.h>
+#include <algorithm>
+#include <unordered_map>
 #include <unistd.h>
 #include <getopt.h>
 #include <syslog.h>
@@ -23,6 +22,24 @@
 #include <BPF.h>
 #include <bcc_common.h>
 
+#include "window_features.h"
+#include "predictor_client.h"
+#include "collector_config.h"
+#include "heavy_hitters.h"
+#include "hyperloglog.h"
+#include "miss_ratio_curve.h"
+#include "pressure_guard.h"
+#include "file_residency.h"
+#include "file_pattern.h"
+#include "device_stack.h"
+#include "bpf_overhead.h"
+#include "overhead_governor.h"
+#include "usdt.h"
+#include "window_trace.h"
+#include "dataset_capture.h"
+#include "timer_wheel.h"
+#include "feature_plan.h"
+
 // ============================================================================
 // CONFIG
 // ============================================================================
@@ -31,10 +48,32 @@
 #define DEFAULT_WINDOW_MS 2500
 #define DEFAULT_SOCK_PATH "/tmp/ml_predictor.sock"
 #define JUMP_THRESHOLD_BYTES 1000000
+#define DEFAULT_DEADLINE_MS 50
+#define BACKOFF_AFTER_FAILURES 3     // fallos seguidos antes de dejar de llamar al daemon
+#define MAX_BACKOFF_WINDOWS 32
+#define TENANT_MAP_SIZE 4096         // entradas del mapa LRU de emisores en BPF
+#define TENANT_TRACK_FACTOR 4        // contadores space-saving por cada emisor reportado
+#define TENANT_DECAY 0.8             // envejecimiento por ventana del top-K
+#define MRC_DECAY 0.9                // envejecimiento por ventana de la curva de fallos
+#define MRC_THRASH_RATIO 0.30        // reusos que no caben en la caché disponible
+#define FILE_MAP_SIZE 4096           // entradas del mapa LRU de archivos leídos en BPF
+#define RESIDENCY_CACHED_HIGH 0.90   // archivos calientes ya casi enteros en caché
+#define BUFFERED_READ_MIN 0.05       // por debajo, el readahead no afecta a la carga
+
+// Entradas de direct I/O donde se marca el hilo (se enganchan las que existan)
+static const char* DIO_ENTRY_POINTS[] = {
+    "iomap_dio_rw", "__iomap_dio_rw", "__blockdev_direct_IO", "blkdev_direct_IO"
+};
 
 static const int READAHEAD_MAP[3] = {256, 16, 64};
+#define CONSERVATIVE_READAHEAD_KB 128   // valor por defecto del kernel, para entradas fuera de distribución
 static const char* CLASS_NAMES[3] = {"sequential", "random", "mixed"};
 
+// Tamaños de caché exportados de la curva de fallos
+static const uint64_t MRC_EXPORT_SIZES[] = {
+    64ULL << 20, 256ULL << 20, 1ULL << 30, 4ULL << 30, 16ULL << 30, 64ULL << 30
+};
+
 // ============================================================================
 // Logging para systemd/journal
 // ============================================================================
@@ -47,32 +86,131 @@ static void log_msg(const std::string& msg, int level = LOG_INFO) {
     }
 }
 
+// Memoria que la caché de páginas podría llegar a ocupar (MemAvailable)
+static uint64_t page_cache_budget_bytes() {
+    std::ifstream in("/proc/meminfo");
+    std::string key;
+    uint64_t kb;
+    std::string unit;
+    while (in >> key >> kb) {
+        std::getline(in, unit);
+        if (key == "MemAvailable:") return kb * 1024;
+    }
+    return 0;
+}
+
 // ============================================================================
-// DATA STRUCTURES (usuario-side)
+// SALIDA CSV DE CARACTERÍSTICAS
 // ============================================================================
 
-struct BlockEvent {
-    uint64_t sector;
-    uint32_t bytes;
-    uint64_t ts;
-    uint32_t rw;
-} __attribute__((packed));
+static FILE* open_features_csv(const std::string& path) {
+    FILE* fp = (path.empty() || path == "-") ? stdout : fopen(path.c_str(), "w");
+    if (!fp) {
+        log_msg("Cannot open features output " + path + ": " + strerror(errno), LOG_ERR);
+        return nullptr;
+    }
+    fprintf(fp, "window_ms,window_index,ts_start_ns,reqs,bytes");
+    for (int i = 0; i < NUM_FEATURES; i++) fprintf(fp, ",%s", FEATURE_NAMES[i]);
+    fprintf(fp, "\n");
+    return fp;
+}
+
+static void write_features_csv_row(FILE* fp, int window_ms, uint64_t idx, uint64_t ts,
+                                   const WindowAggregate& agg, const float* f) {
+    fprintf(fp, "%d,%llu,%llu,%llu,%llu", window_ms, (unsigned long long)idx,
+            (unsigned long long)ts, (unsigned long long)agg.reqs,
+            (unsigned long long)agg.bytes_acc);
+    for (int i = 0; i < NUM_FEATURES; i++) fprintf(fp, ",%.4f", f[i]);
+    fprintf(fp, "\n");
+}
+
+/**
+ * Re-procesa una grabación de eventos (--record) sin BPF ni root.
+ * Una sola pasada calcula todas las resoluciones pedidas.
+ */
+static int replay_events(const std::string& path, const std::vector<int>& resolutions,
+                         uint64_t jump_threshold, const std::string& out_path) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in || !read_event_file_header(in)) {
+        std::cerr << "ERROR: Cannot read event recording " << path << "\n";
+        if (in) fclose(in);
+        return 1;
+    }
+    FILE* out = open_features_csv(out_path);
+    if (!out) {
+        fclose(in);
+        return 1;
+    }
+
+    MultiResolutionExtractor multi(resolutions, jump_threshold,
+        [out](int wms, uint64_t idx, uint64_t ts, const WindowAggregate& agg, const float* f) {
+            write_features_csv_row(out, wms, idx, ts, agg, f);
+        });
+
+    std::vector<BlockEvent> buf(65536);
+    uint64_t total = 0;
+    size_t n;
+    while ((n = fread(buf.data(), sizeof(BlockEvent), buf.size(), in)) > 0) {
+        for (size_t i = 0; i < n; i++) multi.add(buf[i]);
+        total += n;
+    }
+    multi.flush();
+
+    std::cerr << "Replayed " << total << " events (sub-window " << multi.sub_window_ms()
+              << " ms)\n";
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+// ============================================================================
+// AGREGADOS EN EL KERNEL (GOBERNADOR)
+// ============================================================================
+
+// Mismo layout que kagg_key_t / kagg_t en el programa BPF
+struct KernelAggKey {
+    uint32_t dev;
+    uint32_t stream;     // PREDICT_STREAM_*
+    uint32_t slot;       // generación (ver kagg_slot)
+};
 
-struct WindowStats {
-    std::deque<uint64_t> sectors;
-    uint64_t bytes_acc;
+struct KernelAggregate {
     uint64_t reqs;
+    uint64_t bytes;
     uint64_t jumps;
+    uint64_t dist_sum;
+    uint64_t dist_cnt;
+    uint64_t first_sector;
     uint64_t last_sector;
+};
 
-    WindowStats() : bytes_acc(0), reqs(0), jumps(0), last_sector(0) {}
+struct TraceCtl {
+    uint32_t mode;         // TraceMode
+    uint32_t sample_mask;
+};
+
+// ============================================================================
+// EMISORES DE I/O (TENANTS)
+// ============================================================================
+
+// Mismo layout que tenant_key_t / tenant_val_t en el programa BPF
+struct TenantKey {
+    uint64_t cgroup;
+    uint32_t tgid;
+    uint32_t slot;       // generación (ver tenant_slot); no forma parte de la identidad
+
+    bool operator==(const TenantKey& o) const { return cgroup == o.cgroup && tgid == o.tgid; }
+};
+
+struct TenantValue {
+    uint64_t reqs;
+    uint64_t bytes;
+    char comm[16];
+};
 
-    void reset() {
-        sectors.clear();
-        bytes_acc = 0;
-        reqs = 0;
-        jumps = 0;
-        last_sector = 0;
+struct TenantKeyHash {
+    size_t operator()(const TenantKey& k) const {
+        return std::hash<uint64_t>()(k.cgroup * 0x9E3779B97F4A7C15ULL ^ k.tgid);
     }
 };
 
@@ -93,37 +231,493 @@ struct info_t {
 
 BPF_PERF_OUTPUT(events);
 
+// Plan de características (ver feature_plan.h): sin plan se calcula todo
+#ifndef PLAN_STREAMS
+#define PLAN_STREAMS 7
+#endif
+#ifndef PLAN_DISTANCE
+#define PLAN_DISTANCE 1
+#endif
+#ifndef PLAN_TIMESTAMPS
+#define PLAN_TIMESTAMPS 1
+#endif
+
 // Contador para debug
 BPF_ARRAY(event_count, u64, 1);
 
-// Intentar capturar desde block_rq_complete (más universal)
-TRACEPOINT_PROBE(block, block_rq_complete) {
+// Operación y flags de rwbs (ver blk_fill_rwbs). Mismos valores que
+// BLOCK_OP_* / BLOCK_FL_* en window_features.h.
+#define OP_READ      0
+#define OP_WRITE     1
+#define OP_DISCARD   2
+#define OP_SECURE_ERASE 3
+#define OP_FLUSH     4
+#define OP_OTHER     5
+#define FL_PREFLUSH  0x100
+#define FL_FUA       0x200
+#define FL_RAHEAD    0x400
+#define FL_SYNC      0x800
+#define FL_META      0x1000
+
+// rwbs = [F (preflush)] operación [E] [F (fua)] [A] [S] [M]
+static __always_inline u32 decode_rwbs(const char *r) {
+    u32 v = 0;
+    int p = 0;
+    if (r[0] == 'F' && (r[1] == 'R' || r[1] == 'W' || r[1] == 'D' ||
+                        r[1] == 'F' || r[1] == 'N')) {
+        v |= FL_PREFLUSH;
+        p = 1;
+    }
+    char op = p ? r[1] : r[0];
+    char next = p ? r[2] : r[1];
+    if (op == 'R') {
+        v |= OP_READ;
+    } else if (op == 'W' || op == 'w') {
+        v |= OP_WRITE;
+    } else if (op == 'D') {
+        v |= (next == 'E') ? OP_SECURE_ERASE : OP_DISCARD;
+    } else if (op == 'F') {
+        v |= OP_FLUSH;
+    } else {
+        v |= OP_OTHER;
+    }
+
+    int done = 0;
+    #pragma unroll
+    for (int j = 1; j < 8; j++) {
+        char c = r[j];
+        if (c == 0) done = 1;
+        if (done || j <= p) continue;
+        if (c == 'F') v |= FL_FUA;
+        else if (c == 'A') v |= FL_RAHEAD;
+        else if (c == 'S') v |= FL_SYNC;
+        else if (c == 'M') v |= FL_META;
+    }
+    return v;
+}
+
+static __always_inline int is_data_op(u32 v) {
+    return (v & 0x7) == OP_READ || (v & 0x7) == OP_WRITE;
+}
+
+#ifdef TRACK_TENANTS
+// Bytes y peticiones por (cgroup, proceso) en la ventana actual. El mapa LRU
+// acota la memoria: con más emisores que entradas se expulsan los menos
+// recientes. Las claves llevan la generación de tenant_slot: el espacio de
+// usuario la alterna y vacía la anterior mientras el kernel llena la nueva.
+struct tenant_key_t {
+    u64 cgroup;
+    u32 tgid;
+    u32 slot;
+};
+
+struct tenant_val_t {
+    u64 reqs;
+    u64 bytes;
+    char comm[16];
+};
+
+BPF_TABLE("lru_hash", struct tenant_key_t, struct tenant_val_t, tenant_stats, TENANT_MAP_SIZE * 2);
+BPF_ARRAY(tenant_slot, u32, 1);
+
+// block_rq_issue corre normalmente en el contexto de quien envía la I/O; la
+// escritura diferida queda atribuida a los hilos del kernel que la emiten.
+static __always_inline void account_tenant(u32 bytes) {
+    struct tenant_key_t key = {};
+    key.cgroup = bpf_get_current_cgroup_id();
+    key.tgid = bpf_get_current_pid_tgid() >> 32;
+    int zero_idx = 0;
+    u32 *slot = tenant_slot.lookup(&zero_idx);
+    key.slot = slot ? *slot : 0;
+
+    struct tenant_val_t zero = {};
+    struct tenant_val_t *v = tenant_stats.lookup_or_try_init(&key, &zero);
+    if (v) {
+        if (v->reqs == 0) {
+            bpf_get_current_comm(&v->comm, sizeof(v->comm));
+        }
+        __sync_fetch_and_add(&v->reqs, 1);
+        __sync_fetch_and_add(&v->bytes, bytes);
+    }
+}
+#endif
+
+#if defined(TRACK_FILES) || defined(TRACK_FILE_PATTERN)
+// Lecturas con caché por archivo (dev, inode). Se engancha con
+// attach_kprobe a filemap_read o, en kernels < 5.16, a
+// generic_file_read_iter (que también ve O_DIRECT: se descarta).
+struct file_key_t {
+    u64 ino;
+    u32 dev;
+    u32 pad;
+};
+#endif
+
+#ifdef TRACK_FILES
+// Bytes pedidos por archivo en la ventana (residencia, ver file_residency.h)
+struct file_val_t {
+    u64 bytes;
+    u64 reads;
+    u32 tgid;
+    u32 pad;
+};
+
+BPF_TABLE("lru_hash", struct file_key_t, struct file_val_t, file_reads, FILE_MAP_SIZE);
+#endif
+
+#ifdef TRACK_FILE_PATTERN
+// Secuencialidad sobre offsets de archivo (ver file_pattern.h). El estado
+// por archivo persiste entre ventanas; los contadores son acumulados:
+// [0] lecturas, [1] secuenciales, [2] primeras de un archivo, [3] bytes,
+// [4] bytes secuenciales, [5] suma de saltos en bytes.
+struct fpat_state_t {
+    u64 next_off;
+};
+
+BPF_TABLE("lru_hash", struct file_key_t, struct fpat_state_t, file_pattern_state, FILE_MAP_SIZE);
+BPF_PERCPU_ARRAY(file_pattern, u64, 6);
+
+static __always_inline void fpat_add(int idx, u64 v) {
+    u64 *c = file_pattern.lookup(&idx);
+    if (c) {
+        *c += v;
+    }
+}
+
+static __always_inline void file_pattern_update(struct file_key_t *key, u64 off, u64 len) {
+    fpat_add(0, 1);
+    fpat_add(3, len);
+    struct fpat_state_t *st = file_pattern_state.lookup(key);
+    if (!st) {
+        struct fpat_state_t init = {off + len};
+        file_pattern_state.update(key, &init);
+        fpat_add(2, 1);
+        return;
+    }
+    u64 gap = off >= st->next_off ? off - st->next_off : st->next_off - off;
+    if (gap <= FILE_SEQ_GAP) {
+        fpat_add(1, 1);
+        fpat_add(4, len);
+    } else {
+        fpat_add(5, gap);
+    }
+    st->next_off = off + len;
+}
+#endif
+
+#if defined(TRACK_FILES) || defined(TRACK_FILE_PATTERN)
+int trace_file_read(struct pt_regs *ctx, struct kiocb *iocb, struct iov_iter *iter) {
+    if (iocb->ki_flags & IOCB_DIRECT) {
+        return 0;
+    }
+    u64 len = iter->count;
+    if (len == 0) {
+        return 0;
+    }
+
+    struct file_key_t key = {};
+    struct inode *inode = iocb->ki_filp->f_inode;
+    key.ino = inode->i_ino;
+    key.dev = inode->i_sb->s_dev;
+
+#ifdef TRACK_FILES
+    struct file_val_t zero = {};
+    struct file_val_t *v = file_reads.lookup_or_try_init(&key, &zero);
+    if (v) {
+        __sync_fetch_and_add(&v->bytes, len);
+        __sync_fetch_and_add(&v->reads, 1);
+        v->tgid = bpf_get_current_pid_tgid() >> 32;
+    }
+#endif
+#ifdef TRACK_FILE_PATTERN
+    file_pattern_update(&key, iocb->ki_pos, len);
+#endif
+    return 0;
+}
+#endif
+
+#ifdef TRACK_ORIGIN
+// Origen de cada bio: los hilos dentro de una ruta de direct I/O quedan
+// marcados entre la entrada y el retorno (kprobe/kretprobe), y
+// block_bio_queue, que corre en el contexto de quien envía el bio, lo
+// clasifica. Bytes acumulados: [0] lectura directa, [1] lectura con caché,
+// [2] escritura directa, [3] escritura con caché.
+BPF_HASH(dio_threads, u32, u8, 10240);
+BPF_PERCPU_ARRAY(io_origin, u64, 4);
+
+int dio_enter(struct pt_regs *ctx) {
+    u32 tid = bpf_get_current_pid_tgid();
+    u8 one = 1;
+    dio_threads.update(&tid, &one);
+    return 0;
+}
+
+int dio_return(struct pt_regs *ctx) {
+    u32 tid = bpf_get_current_pid_tgid();
+    dio_threads.delete(&tid);
+    return 0;
+}
+
+// Se llama desde block_bio_queue (al final del programa)
+static __always_inline void origin_account(u32 op, u64 bytes) {
+    int idx;
+    if (op == OP_READ) {
+        idx = 1;
+    } else if (op == OP_WRITE) {
+        idx = 3;
+    } else {
+        return;
+    }
+    u32 tid = bpf_get_current_pid_tgid();
+    if (dio_threads.lookup(&tid)) {
+        idx -= 1;
+    }
+    u64 *c = io_origin.lookup(&idx);
+    if (c) {
+        *c += bytes;
+    }
+}
+#endif
+
+#ifdef TRACK_RECLAIM
+// Reclaim de memoria: [0] reclaim directo, [1] despertares de kswapd,
+// [2] páginas recuperadas de las listas inactivas. Contadores acumulados.
+BPF_PERCPU_ARRAY(reclaim_stats, u64, 3);
+
+static __always_inline void reclaim_add(int idx, u64 v) {
+    u64 *c = reclaim_stats.lookup(&idx);
+    if (c) {
+        *c += v;
+    }
+}
+
+TRACEPOINT_PROBE(vmscan, mm_vmscan_direct_reclaim_begin) {
+    reclaim_add(0, 1);
+    return 0;
+}
+
+TRACEPOINT_PROBE(vmscan, mm_vmscan_kswapd_wake) {
+    reclaim_add(1, 1);
+    return 0;
+}
+
+TRACEPOINT_PROBE(vmscan, mm_vmscan_lru_shrink_inactive) {
+    reclaim_add(2, args->nr_reclaimed);
+    return 0;
+}
+#endif
+
+#ifdef TRACK_DISTINCT
+// HyperLogLog de sectores [0] y extents de 1 MB [1] distintos de la ventana
+// (ver hyperloglog.h). Per-CPU: sin atómicos; el espacio de usuario fusiona.
+// Dos generaciones (hll_slot * 2 + sketch): el espacio de usuario alterna
+// hll_slot y reinicia la anterior sin pisar lo que llega mientras la lee.
+struct hll_regs_t {
+    u8 regs[HLL_REGISTERS];
+};
+
+BPF_PERCPU_ARRAY(hll, struct hll_regs_t, 4);
+BPF_ARRAY(hll_slot, u32, 1);
+
+static __always_inline u64 hll_hash(u64 x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// clz(w) + 1 sin bucles (BPF no tiene instrucción clz); w != 0
+static __always_inline u32 hll_rank(u64 w) {
+    u32 n = 1;
+    if ((w >> 32) == 0) { n += 32; w <<= 32; }
+    if ((w >> 48) == 0) { n += 16; w <<= 16; }
+    if ((w >> 56) == 0) { n += 8; w <<= 8; }
+    if ((w >> 60) == 0) { n += 4; w <<= 4; }
+    if ((w >> 62) == 0) { n += 2; w <<= 2; }
+    if ((w >> 63) == 0) { n += 1; }
+    return n;
+}
+
+static __always_inline void hll_add(int sketch, u64 value) {
+    int zero = 0;
+    u32 *slot = hll_slot.lookup(&zero);
+    int idx_sketch = (slot ? (*slot & 1) * 2 : 0) + sketch;
+    struct hll_regs_t *h = hll.lookup(&idx_sketch);
+    if (!h) {
+        return;
+    }
+    u64 x = hll_hash(value);
+    u32 idx = (x >> (64 - HLL_PRECISION)) & (HLL_REGISTERS - 1);
+    u64 w = (x << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1));
+    u8 rank = hll_rank(w);
+    if (rank > h->regs[idx]) {
+        h->regs[idx] = rank;
+    }
+}
+#endif
+
+#ifdef STACK_TOP_DEV
+// Dispositivo apilado (ver device_stack.h): el superior se observa a nivel
+// de bio y las peticiones de sus miembros (que el espacio de usuario carga
+// en este mapa) se descartan para no contarlas dos veces.
+BPF_HASH(stack_members, u32, u8, STACK_MAX_MEMBERS);
+
+static __always_inline int stack_member(u32 dev) {
+    return stack_members.lookup(&dev) != 0;
+}
+#endif
+
+static __always_inline void count_event() {
     int key = 0;
     u64 *count = event_count.lookup(&key);
     if (count) {
         (*count)++;
     }
+}
+
+#ifdef GOVERNOR
+// Modo de trazado por dispositivo (ver overhead_governor.h); sin entrada en
+// trace_ctl el dispositivo está en full. En sampled y aggregate la ventana
+// se agrega aquí con la misma regla que WindowAggregate::add() (issue y
+// complete, como en el espacio de usuario) por flujo: 0 todo, 1 lecturas,
+// 2 escrituras. El espacio de usuario vacía kagg y dev_events por ventana.
+//
+// kagg es por CPU: la lectura-modificación-escritura de kagg_add() no es
+// atómica y bpf_spin_lock no está permitido en tracepoints. Cada CPU ve su
+// subsecuencia de peticiones; el espacio de usuario las encadena. Para no
+// perder los eventos que llegan entre leer y borrar, las entradas llevan la
+// generación de kagg_slot: el espacio de usuario la alterna y vacía la
+// anterior (solo un evento en curso durante el cambio puede caer en ella
+// después de leerla).
+struct trace_ctl_t {
+    u32 mode;
+    u32 sample_mask;
+};
+
+struct kagg_key_t {
+    u32 dev;
+    u32 stream;
+    u32 slot;
+};
+
+struct kagg_t {
+    u64 reqs;
+    u64 bytes;
+    u64 jumps;
+    u64 dist_sum;
+    u64 dist_cnt;
+    u64 first_sector;
+    u64 last_sector;
+};
+
+BPF_HASH(trace_ctl, u32, struct trace_ctl_t, GOV_MAX_DEVICES);
+BPF_PERCPU_HASH(kagg, struct kagg_key_t, struct kagg_t, GOV_MAX_DEVICES * 3 * 2);
+BPF_ARRAY(kagg_slot, u32, 1);
+BPF_HASH(dev_events, u32, u64, GOV_MAX_DEVICES);
+
+static __always_inline void kagg_add(u32 dev, u32 stream, u32 slot, u64 sector, u64 bytes) {
+    struct kagg_key_t k = {dev, stream, slot};
+    struct kagg_t zero = {};
+    struct kagg_t *a = kagg.lookup_or_try_init(&k, &zero);
+    if (!a) {
+        return;
+    }
+    if (a->reqs == 0) {
+        a->first_sector = sector;
+    } else {
+        u64 d = sector > a->last_sector ? sector - a->last_sector : a->last_sector - sector;
+        if (PLAN_DISTANCE) {
+            a->dist_sum += d;
+            a->dist_cnt++;
+        }
+        if (d * 512 > JUMP_THRESHOLD) {
+            a->jumps++;
+        }
+    }
+    a->last_sector = sector;
+    a->bytes += bytes;
+    a->reqs++;
+}
+
+// 1 si el evento se envía al espacio de usuario
+static __always_inline int govern_event(u32 dev, struct info_t *info) {
+    u64 one = 1;
+    u64 *n = dev_events.lookup(&dev);
+    if (n) {
+        __sync_fetch_and_add(n, 1);
+    } else {
+        dev_events.update(&dev, &one);
+    }
+
+    struct trace_ctl_t *ctl = trace_ctl.lookup(&dev);
+    if (!ctl || ctl->mode == 0) {
+        return 1;
+    }
+    if (is_data_op(info->rw)) {
+        u32 stream = (info->rw & 0x7) == OP_WRITE ? 2 : 1;
+        int zero = 0;
+        u32 *cur = kagg_slot.lookup(&zero);
+        u32 slot = cur ? *cur : 0;
+        kagg_add(dev, 0, slot, info->sector, info->bytes);
+        if (PLAN_STREAMS & (1 << stream)) {
+            kagg_add(dev, stream, slot, info->sector, info->bytes);
+        }
+    }
+    if (ctl->mode == 2 || (bpf_get_prandom_u32() & ctl->sample_mask)) {
+        return 0;
+    }
+    info->rw |= 0x40000000;   // BLOCK_EV_SAMPLED
+    return 1;
+}
+#endif
+
+// Envía un evento; en los de issue con datos, además, emisores y HLL
+static __always_inline void submit_event(void *ctx, struct info_t *info, u32 dev) {
+    int emit = 1;
+#ifdef GOVERNOR
+    emit = govern_event(dev, info);
+#endif
+    if (emit) {
+        events.perf_submit(ctx, info, sizeof(*info));
+    }
+    // Discards y flushes no describen el acceso a datos
+    if (!(info->rw & 0x80000000) && is_data_op(info->rw)) {
+#ifdef TRACK_TENANTS
+        account_tenant(info->bytes);
+#endif
+#ifdef TRACK_DISTINCT
+        hll_add(0, info->sector);
+        hll_add(1, info->sector >> HLL_EXTENT_SHIFT);
+#endif
+    }
+}
+
+// Intentar capturar desde block_rq_complete (más universal)
+TRACEPOINT_PROBE(block, block_rq_complete) {
+#ifdef STACK_TOP_DEV
+    if (args->dev == STACK_TOP_DEV || stack_member(args->dev)) {
+        return 0;
+    }
+#endif
+    count_event();
     
     struct info_t info = {};
     
     // Estos campos son estándar en block_rq_complete
     info.sector = args->sector;
     info.bytes  = args->nr_sector * 512;
-    info.ts     = bpf_ktime_get_ns();
-    info.rw = 0;
+    info.ts     = PLAN_TIMESTAMPS ? bpf_ktime_get_ns() : 0;
     
     // Intentar leer rwbs de forma segura
     char rwbs_buf[8] = {};
     bpf_probe_read_kernel(&rwbs_buf, sizeof(rwbs_buf), (void*)args->rwbs);
+    info.rw = 0x80000000 | decode_rwbs(rwbs_buf);   // BLOCK_EV_COMPLETE
     
-    // Detectar escritura
-    if (rwbs_buf[0] == 'W' || rwbs_buf[0] == 'w') {
-        info.rw = 1;
-    }
-    
-    // Solo enviar si hay datos válidos
-    if (info.bytes > 0) {
-        events.perf_submit(args, &info, sizeof(info));
+    // Solo enviar si hay datos válidos (los flush no llevan sectores)
+    if (info.bytes > 0 || (info.rw & 0x7) == OP_FLUSH) {
+        submit_event(args, &info, args->dev);
     }
     
     return 0;
@@ -131,31 +725,77 @@ TRACEPOINT_PROBE(block, block_rq_complete) {
 
 // También intentar con block_rq_issue como backup
 TRACEPOINT_PROBE(block, block_rq_issue) {
-    int key = 0;
-    u64 *count = event_count.lookup(&key);
-    if (count) {
-        (*count)++;
+#ifdef STACK_TOP_DEV
+    if (args->dev == STACK_TOP_DEV || stack_member(args->dev)) {
+        return 0;
     }
+#endif
+    count_event();
     
     struct info_t info = {};
     info.sector = args->sector;
     info.bytes  = args->nr_sector * 512;
-    info.ts     = bpf_ktime_get_ns();
-    info.rw = 0;
+    info.ts     = PLAN_TIMESTAMPS ? bpf_ktime_get_ns() : 0;
     
     char rwbs_buf[8] = {};
     bpf_probe_read_kernel(&rwbs_buf, sizeof(rwbs_buf), (void*)args->rwbs);
+    info.rw = decode_rwbs(rwbs_buf);
     
-    if (rwbs_buf[0] == 'W' || rwbs_buf[0] == 'w') {
-        info.rw = 1;
+    if (info.bytes > 0 || (info.rw & 0x7) == OP_FLUSH) {
+        submit_event(args, &info, args->dev);
     }
     
-    if (info.bytes > 0) {
-        events.perf_submit(args, &info, sizeof(info));
+    return 0;
+}
+
+#if defined(TRACK_ORIGIN) || defined(STACK_TOP_DEV)
+TRACEPOINT_PROBE(block, block_bio_queue) {
+    char rwbs_buf[8] = {};
+    bpf_probe_read_kernel(&rwbs_buf, sizeof(rwbs_buf), (void*)args->rwbs);
+    u32 rw = decode_rwbs(rwbs_buf);
+#ifdef TRACK_ORIGIN
+#ifdef STACK_TOP_DEV
+    // Los bios de los miembros pueden venir de hilos del kernel (dm-crypt):
+    // el origen solo se decide en el dispositivo superior
+    if (!stack_member(args->dev))
+#endif
+    origin_account(rw & 0x7, (u64)args->nr_sector * 512);
+#endif
+#ifdef STACK_TOP_DEV
+    if (args->dev == STACK_TOP_DEV && (args->nr_sector > 0 || (rw & 0x7) == OP_FLUSH)) {
+        count_event();
+        struct info_t info = {};
+        info.sector = args->sector;
+        info.bytes  = args->nr_sector * 512;
+        info.ts     = PLAN_TIMESTAMPS ? bpf_ktime_get_ns() : 0;
+        info.rw     = rw;
+        submit_event(args, &info, args->dev);
     }
-    
+#endif
     return 0;
 }
+#endif
+
+#ifdef STACK_TOP_DEV
+// Fin de los bios del dispositivo superior: el equivalente de block_rq_complete
+TRACEPOINT_PROBE(block, block_bio_complete) {
+    if (args->dev != STACK_TOP_DEV) {
+        return 0;
+    }
+    char rwbs_buf[8] = {};
+    bpf_probe_read_kernel(&rwbs_buf, sizeof(rwbs_buf), (void*)args->rwbs);
+    struct info_t info = {};
+    info.sector = args->sector;
+    info.bytes  = args->nr_sector * 512;
+    info.ts     = PLAN_TIMESTAMPS ? bpf_ktime_get_ns() : 0;
+    info.rw     = 0x80000000 | decode_rwbs(rwbs_buf);   // BLOCK_EV_COMPLETE
+    if (info.bytes > 0 || (info.rw & 0x7) == OP_FLUSH) {
+        count_event();
+        submit_event(args, &info, args->dev);
+    }
+    return 0;
+}
+#endif
 )";
 
 // ============================================================================
@@ -165,13 +805,124 @@ TRACEPOINT_PROBE(block, block_rq_issue) {
 class EBPFBlockTrace {
 private:
     std::string device;
+    // Pila dm/md/multipath del dispositivo: se observa y se actúa en el superior
+    DeviceStack stack;
+    uint32_t device_id;     // dev_t del dispositivo, identifica sus ventanas ante el daemon
     int window_ms;
     std::string sock_path;
+    uint64_t jump_threshold;
     ebpf::BPF* bpf;
-    WindowStats stats;
+    WindowAggregate stats;
+    // Readahead solo afecta a las lecturas: cada flujo tiene su propio
+    // agregado para que las escrituras no rompan la secuencialidad de las
+    // lecturas. El modelo del daemon declara cuál consume.
+    WindowAggregate stats_read;
+    WindowAggregate stats_write;
+    uint32_t model_stream;   // PREDICT_STREAM_*
+    FeaturePlan plan;        // agregados que se calculan (feature_plan.h)
+    bool have_plan;          // plan del bundle (--bundle); si no, todo
+    OpCounters ops;          // peticiones por operación en la ventana (solo issue)
+    OpCounters ops_total;
     bool running;
     uint64_t total_events_received;
 
+    // Camino ML con plazo acotado y respaldo heurístico
+    int deadline_ms;
+    int consecutive_failures;
+    int backoff_windows_left;
+    struct {
+        uint64_t ml_ok;
+        uint64_t fallback_unavailable;  // daemon caído o backlog lleno
+        uint64_t fallback_deadline;     // no respondió dentro del plazo
+        uint64_t fallback_invalid;      // respuesta incompleta, clase o flujo fuera de rango
+        uint64_t fallback_backoff;      // daemon no consultado por fallos recientes
+        uint64_t ood_conservative;      // el daemon marcó la entrada fuera de distribución
+        uint64_t thrash_capped;         // readahead limitado porque la caché ya expulsa reusos
+        uint64_t pressure_capped;       // readahead limitado por presión de memoria/I/O
+        uint64_t cached_hold;           // subida no aplicada: los archivos leídos ya están en caché
+        uint64_t skipped_direct;        // sin cambio: lecturas con caché despreciables
+        uint64_t stream_mismatch;       // el modelo del daemon consume otro flujo
+        uint64_t file_pattern_fallback; // respaldo decidido con el patrón por archivo
+    } counters;
+    PredictResponse last_response;
+
+    // Opciones de compilación del programa BPF (-D...)
+    std::vector<std::string> bpf_cflags;
+
+    // Top-K de emisores por bytes (0 = desactivado)
+    int top_tenants;
+    SpaceSaving<TenantKey, TenantKeyHash>* tenant_tracker;
+    uint32_t tenant_slot;          // generación de tenant_stats en la que escribe el kernel
+    std::unordered_map<TenantKey, std::string, TenantKeyHash> tenant_names;
+
+    // Sectores y extents de 1 MB distintos por ventana (HyperLogLog en BPF)
+    bool track_distinct;
+    double distinct_sectors;
+    double distinct_extents;
+    uint32_t hll_slot;             // generación de hll en la que escribe el kernel
+
+    // Curva de fallos por reuso (SHARDS) y su efecto en la política
+    ShardsMRC* mrc;
+    bool thrashing;
+
+    // Guarda de presión: PSI + reclaim, tope duro de read_ahead_kb
+    bool pressure_guard;
+    PressureMonitor pressure;
+    PressureWindow last_pressure;
+    uint64_t reclaim_prev[3];
+
+    // Residencia en caché de los archivos más leídos (cachestat)
+    FileResidencyTracker* residency;
+    ResidencySummary last_residency;
+
+    // Secuencialidad por offsets de archivo (VFS): lo que hace la aplicación
+    bool track_file_pattern;
+    uint64_t fpat_prev[FPAT_COUNTERS];
+    FilePatternWindow last_file_pattern;
+    int current_ra;         // último read_ahead_kb escrito (-1 = desconocido)
+    uint64_t window_id;     // ventana en curso, para las sondas USDT
+
+    // Desglose por etapas de la latencia de decisión (window_trace.h)
+    bool trace_latency;
+    WindowTrace wtrace;
+    StageHistograms latency;
+    ChromeTraceWriter* chrome_trace;
+
+    // Captura etiquetada del dataset (dataset_capture.h): sin predicción ni actuación
+    DatasetWriter* capture;
+    LabelControl labels;
+    uint64_t capture_start_ns;
+    uint64_t window_open_ns;
+    uint64_t window_completes;
+    uint64_t captured_rows;
+    uint64_t dropped_rows;     // ventanas sin etiqueta o con cambio de etiqueta
+
+    // Direct I/O frente a I/O con caché: sin lecturas con caché el readahead
+    // no tiene efecto y no se toca sysfs
+    bool track_origin;
+    bool suppress_direct;
+    uint64_t origin_prev[4];
+    uint64_t origin_window[4];     // bytes de la ventana, mismo orden que io_origin
+
+    // Coste propio: tiempo de los programas BPF y CPU del proceso
+    BpfOverheadMonitor* overhead;
+    OverheadWindow last_overhead;
+    uint64_t overhead_bpf_total;
+    uint64_t overhead_cpu_total;
+    uint64_t overhead_ios_total;
+
+    // Modo de trazado por dispositivo para no pasar del presupuesto de CPU
+    OverheadGovernor* governor;
+    uint32_t kagg_slot;            // generación de kagg en la que escribe el kernel
+
+    // Métricas por ventana en JSON lines (--metrics-out)
+    FILE* metrics_fp;
+
+    // Salidas opcionales: características multi-resolución y eventos crudos
+    MultiResolutionExtractor* multi;
+    FILE* features_fp;
+    FILE* record_fp;
+
     static void event_callback(void* cookie, void* data, int data_size) {
         if (!cookie) return;
         if (data_size < (int)sizeof(BlockEvent)) return;
@@ -192,59 +943,38 @@ private:
                    " rw=" + std::to_string(e.rw), LOG_INFO);
         }
         
-        stats.sectors.push_back(e.sector);
-        stats.bytes_acc += e.bytes;
-        stats.reqs++;
-
-        if (stats.last_sector != 0) {
-            long long diff = (long long)e.sector - (long long)stats.last_sector;
-            if (diff < 0) diff = -diff;
-            if ((unsigned long long)diff * 512 > (unsigned long long)JUMP_THRESHOLD_BYTES)
-                stats.jumps++;
+        if (!(e.rw & BLOCK_EV_COMPLETE)) ops.add(e.rw, e.bytes);
+        else window_completes++;
+        if (record_fp) fwrite(&e, sizeof(e), 1, record_fp);
+        // Discards, flushes, etc. se cuentan pero no entran en las características
+        if (!block_ev_is_data(e.rw)) return;
+
+        // En modo sampled la ventana ya se agrega en el kernel
+        if (!(e.rw & BLOCK_EV_SAMPLED)) {
+            bool dist = plan.distance();
+            stats.add(e.sector, e.bytes, jump_threshold, dist);
+            if (block_ev_op(e.rw) == BLOCK_OP_WRITE) {
+                if (plan.wants_stream(PREDICT_STREAM_WRITE))
+                    stats_write.add(e.sector, e.bytes, jump_threshold, dist);
+            } else if (plan.wants_stream(PREDICT_STREAM_READ)) {
+                stats_read.add(e.sector, e.bytes, jump_threshold, dist);
+            }
         }
 
-        stats.last_sector = e.sector;
-    }
+        // Cada I/O llega dos veces (issue y complete); la curva de fallos solo la cuenta una
+        if (mrc && !(e.rw & BLOCK_EV_COMPLETE)) mrc->access(e.sector);
 
-    void calculate_features(double window_s, float* f) {
-        if (stats.reqs == 0) {
-            for (int i=0;i<5;i++) f[i]=0.0f;
-            return;
-        }
-
-        double avg_sectors = 0.0;
-        if (stats.sectors.size() > 1) {
-            unsigned long long totald = 0;
-            unsigned long long cnt = 0;
-            uint64_t prev = 0;
-            bool first = true;
-            for (uint64_t s : stats.sectors) {
-                if (!first) {
-                    long long d = (long long)s - (long long)prev;
-                    if (d < 0) d = -d;
-                    totald += (unsigned long long)d;
-                    cnt++;
-                }
-                prev = s;
-                first = false;
-            }
-            if (cnt) avg_sectors = (double)totald / (double)cnt;
-        }
+        if (multi) multi->add(e);
+    }
 
-        float avg_bytes = (float)(avg_sectors * 512.0);
-        float jump_ratio = (stats.reqs>0) ? ((float)stats.jumps / (float)stats.reqs) : 0.0f;
-        float bw_kbps = ((float)stats.bytes_acc / 1024.0f) / (float)window_s;
-        float iops = (float)stats.reqs / (float)window_s;
-        float avg_io_bytes = (iops > 0.001f) ? ((bw_kbps * 1024.0f) / iops) : 0.0f;
-        float seq_ratio = 1.0f - jump_ratio;
-        if (seq_ratio < 0.0f) seq_ratio = 0.0f;
-        if (seq_ratio > 1.0f) seq_ratio = 1.0f;
+    const WindowAggregate& stream_stats(uint32_t stream) const {
+        if (stream == PREDICT_STREAM_READ) return stats_read;
+        if (stream == PREDICT_STREAM_WRITE) return stats_write;
+        return stats;
+    }
 
-        f[0] = avg_bytes;
-        f[1] = jump_ratio;
-        f[2] = avg_io_bytes;
-        f[3] = seq_ratio;
-        f[4] = iops;
+    void calculate_features(double window_s, float* f) {
+        stream_stats(model_stream).features(window_s, f);
     }
 
     std::string format_features(const float* f) {
@@ -256,7 +986,9 @@ private:
             << "avg_io_bytes=" << f[2] << ", "
             << "seq_ratio=" << f[3] << ", "
             << "iops=" << f[4]
-            << "] (reqs=" << stats.reqs << ", bytes=" << stats.bytes_acc << ")";
+            << "] (stream=" << PREDICT_STREAM_NAMES[model_stream]
+            << ", reqs=" << stream_stats(model_stream).reqs
+            << ", bytes=" << stream_stats(model_stream).bytes_acc << ")";
         return oss.str();
     }
 
@@ -264,59 +996,461 @@ private:
         std::string feat_str = format_features(f);
         log_msg("Sending to daemon: " + feat_str, LOG_INFO);
 
-        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
-        if (sock < 0) {
-            log_msg(std::string("socket() failed: ") + strerror(errno), LOG_ERR);
-            return -1;
+        std::string err;
+        uint64_t t0 = USDT_START(readahead, ipc_recv);
+        USDT_PROBE2(readahead, ipc_send, device_id, window_id);
+        PredictTraceRequest treq = {wtrace.id, 0};
+        PredictTraceReply trep;
+        int pred = predictor_request_v2(sock_path, device_id, f, NUM_FEATURES,
+                                        &last_response, &err, deadline_ms, model_stream,
+                                        trace_latency ? &treq : nullptr, &trep);
+        USDT_PROBE4(readahead, ipc_recv, device_id, window_id, pred, usdt_since(t0));
+        if (trace_latency) {
+            wtrace.ts[TP_REQUEST_SENT] = treq.sent_ns;
+            if (pred >= 0) wtrace.mark(TP_REPLY_RECEIVED);
+            if (trep.trace_id == wtrace.id && trep.received_ns) {
+                wtrace.ts[TP_DAEMON_RECEIVED] = trep.received_ns;
+                wtrace.ts[TP_INFERENCE_DONE] = trep.inferred_ns;
+            }
         }
+        if (pred < 0) log_msg(err, LOG_WARNING);
+        return pred;
+    }
 
-        struct sockaddr_un addr;
-        memset(&addr,0,sizeof(addr));
-        addr.sun_family = AF_UNIX;
-        strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path)-1);
+    /**
+     * Clase sin el daemon: el patrón sobre offsets de archivo si hay
+     * lecturas suficientes (es lo que ve el readahead), si no la heurística
+     * sobre las características de bloque.
+     */
+    int fallback_classify(const float* f) {
+        if (track_file_pattern) {
+            int c = last_file_pattern.classify();
+            if (c >= 0) {
+                counters.file_pattern_fallback++;
+                return c;
+            }
+        }
+        return heuristic_classify(f);
+    }
 
-        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            log_msg(std::string("connect() failed: ") + strerror(errno), LOG_WARNING);
-            close(sock);
-            return -1;
+    /**
+     * Decide la clase de la ventana sin bloquearse nunca más de deadline_ms:
+     * si el daemon no está, no responde a tiempo o devuelve basura se usa
+     * fallback_classify(). Tras varios fallos seguidos se deja de consultar
+     * al daemon durante un número creciente de ventanas.
+     */
+    int classify_window(const float* f, bool* from_ml) {
+        *from_ml = false;
+        if (backoff_windows_left > 0) {
+            backoff_windows_left--;
+            counters.fallback_backoff++;
+            return fallback_classify(f);
         }
 
-        ssize_t want = 5 * sizeof(float);
-        ssize_t s = send(sock, f, want, 0);
-        if (s != want) {
-            log_msg("send() failed or partial send", LOG_WARNING);
-            close(sock);
-            return -1;
+        int pred = send_to_daemon(f);
+
+        // Flujo fuera de rango en la respuesta: error de protocolo, no se indexa
+        if (pred >= 0 && (last_response.flags & PREDICT_RESP_STREAM_MISMATCH) &&
+            !predict_stream_valid(predict_resp_stream(last_response.flags)))
+            pred = PREDICT_ERR_PROTOCOL;
+
+        // El modelo consume otro flujo: se usa a partir de la ventana
+        // siguiente y esta se decide con la heurística (no cuenta como fallo)
+        if (pred >= 0 && (last_response.flags & PREDICT_RESP_STREAM_MISMATCH)) {
+            uint32_t s = predict_resp_stream(last_response.flags);
+            log_msg(std::string("Predictor model consumes the ") + PREDICT_STREAM_NAMES[s] +
+                    " stream, switching features from " + PREDICT_STREAM_NAMES[model_stream],
+                    LOG_WARNING);
+            model_stream = s;
+            if (!plan.wants_stream(s)) {
+                plan.need_stream(s);
+                if (governor)
+                    log_msg(std::string("Feature plan had no ") + PREDICT_STREAM_NAMES[s] +
+                            " aggregate in BPF: sampled/aggregate windows lack it until restart "
+                            "with the daemon's bundle", LOG_WARNING);
+            }
+            counters.stream_mismatch++;
+            return fallback_classify(f);
         }
 
-        int pred = -1;
-        ssize_t r = recv(sock, &pred, sizeof(pred), 0);
-        if (r != (ssize_t)sizeof(pred)) {
-            log_msg("recv() failed", LOG_WARNING);
-            close(sock);
-            return -1;
+        if (pred >= 0 && pred < 3) {
+            counters.ml_ok++;
+            consecutive_failures = 0;
+            *from_ml = true;
+            return pred;
         }
 
-        close(sock);
-        return pred;
+        if (pred == PREDICT_ERR_DEADLINE) counters.fallback_deadline++;
+        else if (pred == PREDICT_ERR_UNAVAILABLE || pred == PREDICT_ERR_BACKLOG)
+            counters.fallback_unavailable++;
+        else counters.fallback_invalid++;
+
+        consecutive_failures++;
+        if (consecutive_failures >= BACKOFF_AFTER_FAILURES) {
+            int shift = std::min(consecutive_failures - BACKOFF_AFTER_FAILURES, 5);
+            backoff_windows_left = std::min(1 << shift, MAX_BACKOFF_WINDOWS);
+            log_msg("Predictor failing (" + std::to_string(consecutive_failures) +
+                    " in a row), using heuristic for the next " +
+                    std::to_string(backoff_windows_left) + " windows", LOG_WARNING);
+        }
+        return fallback_classify(f);
+    }
+
+    void log_prediction_counters() {
+        log_msg("Decisions: ml=" + std::to_string(counters.ml_ok) +
+                " fallback_unavailable=" + std::to_string(counters.fallback_unavailable) +
+                " fallback_deadline=" + std::to_string(counters.fallback_deadline) +
+                " fallback_invalid=" + std::to_string(counters.fallback_invalid) +
+                " fallback_backoff=" + std::to_string(counters.fallback_backoff) +
+                " ood_conservative=" + std::to_string(counters.ood_conservative) +
+                " thrash_capped=" + std::to_string(counters.thrash_capped) +
+                " pressure_capped=" + std::to_string(counters.pressure_capped) +
+                " cached_hold=" + std::to_string(counters.cached_hold) +
+                " skipped_direct=" + std::to_string(counters.skipped_direct) +
+                " stream_mismatch=" + std::to_string(counters.stream_mismatch) +
+                " file_pattern_fallback=" + std::to_string(counters.file_pattern_fallback), LOG_INFO);
+    }
+
+    int read_readahead() {
+        std::ifstream rf(stack.readahead_path());
+        int val = -1;
+        if (!(rf >> val)) return -1;
+        return val;
     }
 
     bool write_readahead(int val) {
-        std::string path = "/sys/block/sda/queue/read_ahead_kb";
+        std::string path = stack.readahead_path();
         
         log_msg("Writing read_ahead_kb=" + std::to_string(val) + " to " + path, LOG_INFO);
         
+        uint64_t t0 = USDT_START(readahead, sysfs_write);
         std::ofstream wf(path);
         if (!wf.is_open()) {
+            USDT_PROBE5(readahead, sysfs_write, device_id, window_id, val, usdt_since(t0), 0);
             log_msg("Failed writing sysfs: " + path + " - " + strerror(errno), LOG_WARNING);
             return false;
         }
         wf << val << std::endl;
         wf.close();
+        USDT_PROBE5(readahead, sysfs_write, device_id, window_id, val, usdt_since(t0), 1);
+        current_ra = val;
         
         return true;
     }
 
+    /**
+     * Vacía el mapa de emisores de la ventana, actualiza el top-K y registra
+     * las estadísticas exactas de la ventana para esos K más el resto
+     * agregado como "other".
+     */
+    void report_tenants() {
+        // Alternar la generación antes de leer: las entradas de la anterior ya
+        // no cambian (salvo un evento en curso durante el cambio) y se borran
+        // una a una sin tocar las de la ventana que empieza
+        uint32_t old_slot = tenant_slot;
+        tenant_slot ^= 1;
+        bpf->get_array_table<uint32_t>("tenant_slot").update_value(0, tenant_slot);
+
+        auto table = bpf->get_hash_table<TenantKey, TenantValue>("tenant_stats");
+        std::vector<std::pair<TenantKey, TenantValue>> entries;
+        for (const auto& kv : table.get_table_offline()) {
+            if (kv.first.slot != old_slot) continue;
+            table.remove_value(kv.first);
+            entries.push_back(kv);
+            entries.back().first.slot = 0;
+        }
+
+        std::unordered_map<TenantKey, TenantValue, TenantKeyHash> window;
+        uint64_t total_reqs = 0, total_bytes = 0;
+        for (const auto& kv : entries) {
+            window[kv.first] = kv.second;
+            total_reqs += kv.second.reqs;
+            total_bytes += kv.second.bytes;
+            tenant_tracker->add(kv.first, (double)kv.second.bytes);
+        }
+
+        auto top = tenant_tracker->top(top_tenants);
+        std::unordered_map<TenantKey, std::string, TenantKeyHash> names;
+        std::ostringstream oss;
+        oss << "Top tenants (" << entries.size() << " active):";
+        uint64_t top_reqs = 0, top_bytes = 0;
+        for (const auto& c : top) {
+            auto w = window.find(c.key);
+            std::string comm = tenant_names.count(c.key) ? tenant_names[c.key] : "?";
+            uint64_t reqs = 0, bytes = 0;
+            if (w != window.end()) {
+                comm = std::string(w->second.comm, strnlen(w->second.comm, sizeof(w->second.comm)));
+                reqs = w->second.reqs;
+                bytes = w->second.bytes;
+            }
+            names[c.key] = comm;
+            top_reqs += reqs;
+            top_bytes += bytes;
+            oss << " [" << comm << " pid=" << c.key.tgid << " cg=" << c.key.cgroup
+                << " reqs=" << reqs << " bytes=" << bytes << "]";
+        }
+        oss << " [other reqs=" << (total_reqs - top_reqs)
+            << " bytes=" << (total_bytes - top_bytes) << "]";
+        log_msg(oss.str(), LOG_INFO);
+
+        // Solo se recuerdan los nombres del top-K actual: memoria acotada
+        tenant_names.swap(names);
+        tenant_tracker->decay(TENANT_DECAY);
+    }
+
+    /**
+     * Lee y reinicia los sketches HLL de la ventana (todas las CPUs). Alterna
+     * antes la generación: el kernel ya escribe en la otra, así que el
+     * reinicio no borra eventos (salvo uno en curso durante el cambio).
+     */
+    void report_distinct() {
+        int old_slot = (int)hll_slot;
+        hll_slot ^= 1;
+        bpf->get_array_table<uint32_t>("hll_slot").update_value(0, hll_slot);
+
+        auto table = bpf->get_percpu_array_table<HllRegisters>("hll");
+        double est[2] = {0.0, 0.0};
+        for (int i = 0; i < 2; i++) {
+            std::vector<HllRegisters> cpus;
+            int idx = old_slot * 2 + i;
+            if (table.get_value(idx, cpus).code() != 0) {
+                log_msg("Cannot read HLL sketch " + std::to_string(i), LOG_WARNING);
+                return;
+            }
+            est[i] = hll_estimate(hll_merge(cpus));
+            for (HllRegisters& h : cpus) memset(&h, 0, sizeof(h));
+            table.update_value(idx, cpus);
+        }
+        distinct_sectors = est[0];
+        distinct_extents = est[1];
+
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(0)
+            << "Distinct (HLL): sectors~" << distinct_sectors
+            << " extents_1mb~" << distinct_extents;
+        log_msg(oss.str(), LOG_INFO);
+    }
+
+    /**
+     * Evalúa la curva de fallos contra la memoria disponible: si muchos
+     * reusos ya no caben, prefetch agresivo solo expulsaría más datos útiles.
+     */
+    void evaluate_mrc() {
+        uint64_t budget = page_cache_budget_bytes();
+        double reuse_miss = budget ? mrc->reuse_miss_ratio(budget) : 0.0;
+        thrashing = reuse_miss > MRC_THRASH_RATIO;
+
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(3)
+            << "MRC: working_set=" << (mrc->working_set_bytes() >> 20) << " MB"
+            << " cache_budget=" << (budget >> 20) << " MB"
+            << " miss_ratio=" << mrc->miss_ratio(budget)
+            << " reuse_miss=" << reuse_miss
+            << " rate=" << mrc->sampling_rate()
+            << (thrashing ? " (thrashing)" : "");
+        log_msg(oss.str(), LOG_INFO);
+    }
+
+    // PSI de la ventana más los eventos de reclaim contados en BPF
+    void sample_pressure() {
+        last_pressure = pressure.sample();
+
+        auto table = bpf->get_percpu_array_table<uint64_t>("reclaim_stats");
+        uint64_t* out[3] = {&last_pressure.direct_reclaims, &last_pressure.kswapd_wakes,
+                            &last_pressure.pages_reclaimed};
+        for (int i = 0; i < 3; i++) {
+            std::vector<uint64_t> cpus;
+            if (table.get_value(i, cpus).code() != 0) continue;
+            uint64_t total = 0;
+            for (uint64_t v : cpus) total += v;
+            *out[i] = total - reclaim_prev[i];
+            reclaim_prev[i] = total;
+        }
+
+        if (last_pressure.have_system || last_pressure.direct_reclaims > 0) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3)
+                << "Pressure: io some=" << last_pressure.io_some << " full=" << last_pressure.io_full
+                << " mem some=" << last_pressure.mem_some << " full=" << last_pressure.mem_full;
+            if (last_pressure.have_cgroup)
+                oss << " | cgroup io full=" << last_pressure.cg_io_full
+                    << " mem full=" << last_pressure.cg_mem_full;
+            oss << " | direct_reclaims=" << last_pressure.direct_reclaims
+                << " kswapd_wakes=" << last_pressure.kswapd_wakes
+                << " pages_reclaimed=" << last_pressure.pages_reclaimed;
+            log_msg(oss.str(), LOG_INFO);
+        }
+    }
+
+    // Vacía el mapa de archivos leídos y muestrea la residencia del top-K
+    void sample_residency() {
+        auto table = bpf->get_hash_table<FileKey, FileReadValue>("file_reads");
+        std::vector<std::pair<FileKey, FileReadValue>> entries = table.get_table_offline();
+        table.clear_table_non_atomic();
+
+        last_residency = residency->update(entries);
+        if (last_residency.valid) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3)
+                << "Hot files: " << last_residency.files << " sampled, cached_fraction="
+                << last_residency.cached_fraction
+                << " recently_evicted=" << last_residency.recently_evicted << " pages";
+            log_msg(oss.str(), LOG_INFO);
+        }
+    }
+
+    // Lecturas por offset de archivo de la ventana
+    void sample_file_pattern() {
+        auto table = bpf->get_percpu_array_table<uint64_t>("file_pattern");
+        uint64_t now[FPAT_COUNTERS] = {};
+        for (int i = 0; i < FPAT_COUNTERS; i++) {
+            std::vector<uint64_t> cpus;
+            if (table.get_value(i, cpus).code() != 0) continue;
+            for (uint64_t v : cpus) now[i] += v;
+        }
+        last_file_pattern = FilePatternWindow::delta(now, fpat_prev);
+        const FilePatternWindow& w = last_file_pattern;
+        if (w.reads() > 0) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3)
+                << "File reads: " << w.reads() << " (seq_ratio=" << w.seq_ratio()
+                << ", avg_read=" << (uint64_t)w.avg_read_bytes()
+                << " B, avg_gap=" << (uint64_t)w.avg_gap_bytes() << " B)";
+            int c = w.classify();
+            if (c >= 0) oss << " -> " << CLASS_NAMES[c];
+            log_msg(oss.str(), LOG_INFO);
+        }
+    }
+
+    // Bytes por origen (directo / con caché) de la ventana
+    void sample_origin() {
+        auto table = bpf->get_percpu_array_table<uint64_t>("io_origin");
+        for (int i = 0; i < 4; i++) {
+            std::vector<uint64_t> cpus;
+            origin_window[i] = 0;
+            if (table.get_value(i, cpus).code() != 0) continue;
+            uint64_t total = 0;
+            for (uint64_t v : cpus) total += v;
+            origin_window[i] = total - origin_prev[i];
+            origin_prev[i] = total;
+        }
+    }
+
+    // Fracción de bytes leídos que pasan por la caché de páginas (-1 sin lecturas)
+    double buffered_read_fraction() const {
+        uint64_t reads = origin_window[0] + origin_window[1];
+        return reads ? (double)origin_window[1] / reads : -1.0;
+    }
+
+    void write_metrics(int window, const float* f, int pred, const char* source, int ra) {
+        std::ostringstream js;
+        js << std::setprecision(6)
+           << "{\"window\":" << window
+           << ",\"ts_ms\":" << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count()
+           << ",\"device\":\"" << device << "\""
+           << ",\"reqs\":" << stats.reqs << ",\"bytes\":" << stats.bytes_acc
+           << ",\"stream\":\"" << PREDICT_STREAM_NAMES[model_stream] << "\""
+           << ",\"features\":{";
+        for (int i = 0; i < NUM_FEATURES; i++)
+            js << (i ? "," : "") << "\"" << FEATURE_NAMES[i] << "\":" << f[i];
+        // Características de los tres flujos, en el orden de FEATURE_NAMES
+        js << "},\"streams\":{";
+        for (uint32_t st = 0; st < 3; st++) {
+            const WindowAggregate& a = stream_stats(st);
+            float sf[NUM_FEATURES];
+            a.features((double)window_ms / 1000.0, sf);
+            js << (st ? "," : "") << "\"" << PREDICT_STREAM_NAMES[st] << "\":{\"reqs\":" << a.reqs
+               << ",\"bytes\":" << a.bytes_acc << ",\"features\":[";
+            for (int i = 0; i < NUM_FEATURES; i++) js << (i ? "," : "") << sf[i];
+            js << "]}";
+        }
+        js << "},\"ops\":{";
+        for (int i = 0; i < BLOCK_OP_COUNT; i++)
+            js << "\"" << BLOCK_OP_NAMES[i] << "\":" << ops.reqs[i] << ",";
+        js << "\"discard_bytes\":" << ops.bytes[BLOCK_OP_DISCARD] + ops.bytes[BLOCK_OP_SECURE_ERASE]
+           << ",\"rahead\":" << ops.rahead << ",\"sync\":" << ops.sync
+           << ",\"meta\":" << ops.meta << ",\"fua\":" << ops.fua
+           << ",\"preflush\":" << ops.preflush;
+        js << "},\"class\":\"" << CLASS_NAMES[pred] << "\",\"source\":\"" << source << "\""
+           << ",\"read_ahead_kb\":" << ra;
+        if (track_distinct)
+            js << ",\"distinct_sectors\":" << distinct_sectors
+               << ",\"distinct_extents\":" << distinct_extents;
+        if (pressure_guard) {
+            const PressureWindow& p = last_pressure;
+            js << ",\"pressure\":{\"io_some\":" << p.io_some << ",\"io_full\":" << p.io_full
+               << ",\"mem_some\":" << p.mem_some << ",\"mem_full\":" << p.mem_full;
+            if (p.have_cgroup)
+                js << ",\"cg_io_some\":" << p.cg_io_some << ",\"cg_io_full\":" << p.cg_io_full
+                   << ",\"cg_mem_some\":" << p.cg_mem_some << ",\"cg_mem_full\":" << p.cg_mem_full;
+            js << ",\"direct_reclaims\":" << p.direct_reclaims
+               << ",\"kswapd_wakes\":" << p.kswapd_wakes
+               << ",\"pages_reclaimed\":" << p.pages_reclaimed << "}";
+        }
+        if (track_origin)
+            js << ",\"origin\":{\"direct_read_bytes\":" << origin_window[0]
+               << ",\"buffered_read_bytes\":" << origin_window[1]
+               << ",\"direct_write_bytes\":" << origin_window[2]
+               << ",\"buffered_write_bytes\":" << origin_window[3]
+               << ",\"buffered_read_fraction\":" << buffered_read_fraction() << "}";
+        if (overhead) {
+            const OverheadWindow& o = last_overhead;
+            js << ",\"overhead\":{\"bpf_ns\":" << o.bpf_ns << ",\"cpu_ns\":" << o.cpu_ns
+               << ",\"wall_s\":" << o.wall_s << ",\"programs\":{";
+            for (size_t i = 0; i < o.programs.size(); i++)
+                js << (i ? "," : "") << "\"" << o.programs[i].name << "\":{\"runs\":"
+                   << o.programs[i].runs << ",\"ns_per_run\":" << o.programs[i].ns_per_run() << "}";
+            js << "}}";
+        }
+        if (trace_latency) {
+            js << ",\"latency_us\":{";
+            bool first = true;
+            for (int s = 0; s < TRACE_STAGES; s++) {
+                uint64_t ns = wtrace.stage_ns(s);
+                if (!ns) continue;
+                js << (first ? "" : ",") << "\"" << TRACE_STAGE_NAMES[s] << "\":" << ns / 1e3;
+                first = false;
+            }
+            js << "}";
+        }
+        if (governor) {
+            js << ",\"governor\":{\"budget_pct\":" << governor->budget_pct() << ",\"modes\":{";
+            bool first = true;
+            for (const auto& kv : governor->all()) {
+                js << (first ? "" : ",") << "\"" << devt_name(kv.first) << "\":\""
+                   << TRACE_MODE_NAMES[kv.second.mode] << "\"";
+                first = false;
+            }
+            js << "}}";
+        }
+        if (track_file_pattern && last_file_pattern.reads() > 0)
+            js << ",\"file_pattern\":{\"reads\":" << last_file_pattern.reads()
+               << ",\"seq_ratio\":" << last_file_pattern.seq_ratio()
+               << ",\"avg_read_bytes\":" << last_file_pattern.avg_read_bytes()
+               << ",\"avg_gap_bytes\":" << last_file_pattern.avg_gap_bytes()
+               << ",\"class\":" << last_file_pattern.classify() << "}";
+        if (residency && last_residency.valid)
+            js << ",\"residency\":{\"files\":" << last_residency.files
+               << ",\"cached_fraction\":" << last_residency.cached_fraction
+               << ",\"recently_evicted\":" << last_residency.recently_evicted << "}";
+        if (mrc) {
+            js << ",\"mrc\":{\"rate\":" << mrc->sampling_rate()
+               << ",\"working_set_bytes\":" << mrc->working_set_bytes()
+               << ",\"thrashing\":" << (thrashing ? "true" : "false")
+               << ",\"cache_bytes\":[";
+            for (size_t i = 0; i < sizeof(MRC_EXPORT_SIZES) / sizeof(MRC_EXPORT_SIZES[0]); i++)
+                js << (i ? "," : "") << MRC_EXPORT_SIZES[i];
+            js << "],\"miss_ratio\":[";
+            for (size_t i = 0; i < sizeof(MRC_EXPORT_SIZES) / sizeof(MRC_EXPORT_SIZES[0]); i++)
+                js << (i ? "," : "") << mrc->miss_ratio(MRC_EXPORT_SIZES[i]);
+            js << "]}";
+        }
+        js << "}\n";
+        fputs(js.str().c_str(), metrics_fp);
+        fflush(metrics_fp);
+    }
+
     void check_kernel_events() {
         // Leer contador de eventos del kernel
         auto table = bpf->get_array_table<uint64_t>("event_count");
@@ -332,29 +1466,515 @@ private:
     }
 
 public:
-    EBPFBlockTrace(const std::string& dev, int winms, const std::string& sock)
-        : device(dev), window_ms(winms), sock_path(sock), bpf(nullptr), 
-          running(false), total_events_received(0) {}
+    EBPFBlockTrace(const std::string& dev, int winms, const std::string& sock,
+                   uint64_t jump_thr = JUMP_THRESHOLD_BYTES)
+        : device(dev), stack(build_device_stack(dev)),
+          device_id(stack.top_dev ? stack.top_dev : device_id_of(dev)), window_ms(winms), sock_path(sock), jump_threshold(jump_thr), bpf(nullptr), 
+          model_stream(PREDICT_STREAM_ALL), have_plan(false), running(false), total_events_received(0),
+          deadline_ms(DEFAULT_DEADLINE_MS), consecutive_failures(0), backoff_windows_left(0),
+          counters(), last_response(),
+          top_tenants(0), tenant_tracker(nullptr), tenant_slot(0),
+          track_distinct(false), distinct_sectors(0.0), distinct_extents(0.0), hll_slot(0),
+          mrc(nullptr), thrashing(false),
+          pressure_guard(false), last_pressure(), reclaim_prev(),
+          residency(nullptr), last_residency(),
+          track_file_pattern(false), fpat_prev(), last_file_pattern(), current_ra(-1), window_id(0),
+          trace_latency(false), wtrace(), latency(), chrome_trace(nullptr),
+          capture(nullptr), labels(), capture_start_ns(0), window_open_ns(0), window_completes(0),
+          captured_rows(0), dropped_rows(0),
+          track_origin(false), suppress_direct(false), origin_prev(), origin_window(),
+          overhead(nullptr), last_overhead(), overhead_bpf_total(0), overhead_cpu_total(0),
+          overhead_ios_total(0), governor(nullptr), kagg_slot(0),
+          metrics_fp(nullptr),
+          multi(nullptr), features_fp(nullptr), record_fp(nullptr) {}
 
     ~EBPFBlockTrace() {
+        if (multi) {
+            multi->flush();
+            delete multi;
+        }
+        if (features_fp) fclose(features_fp);
+        if (record_fp) fclose(record_fp);
+        if (tenant_tracker) delete tenant_tracker;
+        if (mrc) delete mrc;
+        if (residency) delete residency;
+        if (overhead) delete overhead;
+        if (chrome_trace) delete chrome_trace;
+        if (capture) delete capture;
+        if (governor) delete governor;
+        if (metrics_fp && metrics_fp != stdout) fclose(metrics_fp);
         if (bpf) delete bpf;
     }
 
+    void set_deadline_ms(int ms) { deadline_ms = ms; }
+
+    /**
+     * Limita read_ahead_kb según la presión de memoria e I/O (PSI del
+     * sistema y, si se da, del cgroup) y el reclaim; llamar antes de init().
+     */
+    void enable_pressure_guard(const std::string& cgroup_dir) {
+        pressure_guard = true;
+        pressure.set_cgroup(cgroup_dir);
+        bpf_cflags.push_back("-DTRACK_RECLAIM");
+        if (!pressure.available())
+            log_msg("PSI not available (/proc/pressure), pressure guard uses reclaim events only",
+                    LOG_WARNING);
+        log_msg("Pressure guard enabled" +
+                (cgroup_dir.empty() ? std::string() : " (cgroup " + cgroup_dir + ")"), LOG_INFO);
+    }
+
+    /**
+     * Sigue los k archivos con más lecturas con caché y muestrea su
+     * residencia con cachestat; llamar antes de init().
+     */
+    bool enable_file_residency(int k) {
+        residency = new FileResidencyTracker((size_t)k);
+        if (!residency->probe_support()) {
+            log_msg("cachestat() not supported by this kernel (needs Linux 6.5+)", LOG_ERR);
+            delete residency;
+            residency = nullptr;
+            return false;
+        }
+        bpf_cflags.push_back("-DTRACK_FILES");
+        add_file_map_cflag();
+        log_msg("Hot file residency enabled (top " + std::to_string(k) + " files)", LOG_INFO);
+        return true;
+    }
+
+    // FILE_MAP_SIZE lo comparten la residencia y el patrón por archivo
+    void add_file_map_cflag() {
+        std::string flag = "-DFILE_MAP_SIZE=" + std::to_string(FILE_MAP_SIZE);
+        if (std::find(bpf_cflags.begin(), bpf_cflags.end(), flag) == bpf_cflags.end())
+            bpf_cflags.push_back(flag);
+    }
+
+    /**
+     * Secuencialidad de las lecturas sobre offsets de archivo; sin daemon,
+     * el respaldo la usa en lugar de la heurística de bloque. Llamar antes
+     * de init().
+     */
+    void enable_file_pattern() {
+        track_file_pattern = true;
+        bpf_cflags.push_back("-DTRACK_FILE_PATTERN");
+        bpf_cflags.push_back("-DFILE_SEQ_GAP=" + std::to_string(FILE_SEQ_GAP_BYTES));
+        add_file_map_cflag();
+        log_msg("File offset pattern detection enabled", LOG_INFO);
+    }
+
+    /**
+     * Distingue direct I/O de I/O con caché; con suppress, no se cambia
+     * read_ahead_kb en ventanas sin lecturas con caché. Llamar antes de init().
+     */
+    void enable_origin_tracking(bool suppress) {
+        track_origin = true;
+        suppress_direct = suppress;
+        bpf_cflags.push_back("-DTRACK_ORIGIN");
+    }
+
+    /**
+     * Mide el tiempo de cada programa BPF y la CPU del colector por
+     * ventana; llamar antes de init().
+     */
+    bool enable_overhead() {
+        overhead = new BpfOverheadMonitor();
+        std::string how = overhead->enable();
+        if (how.empty()) {
+            log_msg(std::string("Cannot enable BPF run time stats: ") + strerror(errno), LOG_ERR);
+            delete overhead;
+            overhead = nullptr;
+            return false;
+        }
+        log_msg("BPF run time stats enabled via " + how, LOG_INFO);
+        return true;
+    }
+
+    // Registra los programas cargados según las opciones activas
+    void register_overhead_programs() {
+        std::vector<std::pair<std::string, bpf_prog_type>> progs = {
+            {"block_rq_issue", BPF_PROG_TYPE_TRACEPOINT},
+            {"block_rq_complete", BPF_PROG_TYPE_TRACEPOINT},
+        };
+        if (track_origin || stack.stacked()) progs.push_back({"block_bio_queue", BPF_PROG_TYPE_TRACEPOINT});
+        if (stack.stacked()) progs.push_back({"block_bio_complete", BPF_PROG_TYPE_TRACEPOINT});
+        if (pressure_guard) {
+            progs.push_back({"mm_vmscan_direct_reclaim_begin", BPF_PROG_TYPE_TRACEPOINT});
+            progs.push_back({"mm_vmscan_kswapd_wake", BPF_PROG_TYPE_TRACEPOINT});
+            progs.push_back({"mm_vmscan_lru_shrink_inactive", BPF_PROG_TYPE_TRACEPOINT});
+        }
+        if (residency || track_file_pattern) progs.push_back({"trace_file_read", BPF_PROG_TYPE_KPROBE});
+        if (track_origin) {
+            progs.push_back({"dio_enter", BPF_PROG_TYPE_KPROBE});
+            progs.push_back({"dio_return", BPF_PROG_TYPE_KPROBE});
+        }
+
+        for (const auto& p : progs) {
+            // TRACEPOINT_PROBE(cat, ev) genera la función tracepoint__cat__ev
+            std::string fn = p.first;
+            if (p.second == BPF_PROG_TYPE_TRACEPOINT)
+                fn = std::string(p.first.compare(0, 9, "mm_vmscan") == 0 ? "tracepoint__vmscan__"
+                                                                          : "tracepoint__block__") + p.first;
+            int fd = -1;
+            if (bpf->load_func(fn, p.second, fd).code() != 0 || fd < 0) {
+                log_msg("Cannot get fd of BPF program " + fn, LOG_WARNING);
+                continue;
+            }
+            overhead->add_program(p.first, fd);
+        }
+        overhead->start();
+        log_msg("Measuring overhead of " + std::to_string(overhead->size()) + " BPF programs",
+                LOG_INFO);
+    }
+
+    // Coste de la ventana: ns por disparo de cada programa y CPU del proceso
+    void sample_overhead(uint64_t ios) {
+        last_overhead = overhead->sample();
+        const OverheadWindow& w = last_overhead;
+        overhead_bpf_total += w.bpf_ns;
+        overhead_cpu_total += w.cpu_ns;
+        overhead_ios_total += ios;
+
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(0) << "BPF overhead:";
+        for (const ProgramCost& c : w.programs)
+            if (c.runs) oss << " " << c.name << "=" << c.ns_per_run() << "ns x" << c.runs;
+        oss << std::setprecision(2)
+            << " | per I/O " << (ios ? (double)w.bpf_ns / ios : 0.0) << " ns"
+            << " | BPF " << w.bpf_ns / 1e6 << " ms, collector CPU " << w.cpu_ns / 1e6 << " ms ("
+            << (w.wall_s > 0 ? 100.0 * w.cpu_ns / 1e9 / w.wall_s : 0.0) << "% of one CPU)";
+        log_msg(oss.str(), LOG_INFO);
+    }
+
+    /**
+     * Mantiene el coste de trazado bajo budget_pct % de la CPU del host
+     * cambiando el modo de cada dispositivo (ver overhead_governor.h).
+     * Necesita enable_overhead(); llamar antes de init().
+     */
+    void enable_governor(double budget_pct) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        governor = new OverheadGovernor(budget_pct, (int)cpus);
+        bpf_cflags.push_back("-DGOVERNOR");
+        bpf_cflags.push_back("-DGOV_MAX_DEVICES=" + std::to_string(GOV_MAX_DEVICES));
+        bpf_cflags.push_back("-DJUMP_THRESHOLD=" + std::to_string(jump_threshold) + "ULL");
+        std::ostringstream oss;
+        oss << "Overhead governor enabled (budget " << budget_pct << "% of " << cpus << " CPUs)";
+        log_msg(oss.str(), LOG_INFO);
+    }
+
+    /**
+     * Suma a los agregados de la ventana lo agregado en el kernel
+     * (sampled/aggregate). Alterna la generación de kagg y vacía la anterior;
+     * las entradas por CPU se encadenan en orden de CPU, así que entre CPUs
+     * se cuenta una distancia de más por cada subsecuencia.
+     */
+    void merge_kernel_aggregates() {
+        uint32_t old_slot = kagg_slot;
+        kagg_slot ^= 1;
+        bpf->get_array_table<uint32_t>("kagg_slot").update_value(0, kagg_slot);
+
+        // Solo hay entradas de los dispositivos que el gobernador sacó de full:
+        // los cambios de modo se aplican después de esta mezcla
+        auto table = bpf->get_percpu_hash_table<KernelAggKey, KernelAggregate>("kagg");
+        for (const auto& dev : governor->all()) {
+            if (dev.second.mode == TRACE_FULL) continue;
+            for (uint32_t s = PREDICT_STREAM_ALL; s <= PREDICT_STREAM_WRITE; s++) {
+                if (!plan.wants_stream(s)) continue;
+                KernelAggKey key = {dev.first, s, old_slot};
+                std::vector<KernelAggregate> per_cpu;
+                if (!table.get_value(key, per_cpu).ok()) continue;
+                table.remove_value(key);
+                WindowAggregate& dst = s == PREDICT_STREAM_READ ? stats_read
+                                     : s == PREDICT_STREAM_WRITE ? stats_write : stats;
+                for (const KernelAggregate& k : per_cpu) {
+                    WindowAggregate w;
+                    w.reqs = k.reqs;
+                    w.bytes_acc = k.bytes;
+                    w.jumps = k.jumps;
+                    w.dist_sum = k.dist_sum;
+                    w.dist_cnt = k.dist_cnt;
+                    w.first_sector = k.first_sector;
+                    w.last_sector = k.last_sector;
+                    dst.merge(w, jump_threshold);
+                }
+            }
+        }
+    }
+
+    static std::string devt_name(uint32_t dev) {
+        return std::to_string(dev >> 20) + ":" + std::to_string(dev & 0xFFFFF);
+    }
+
+    // Un paso del gobernador con el coste de la ventana y los eventos por dispositivo
+    void govern(uint64_t streamed) {
+        auto table = bpf->get_hash_table<uint32_t, uint64_t>("dev_events");
+        std::map<uint32_t, uint64_t> dev_events;
+        for (const auto& kv : table.get_table_offline()) dev_events[kv.first] = kv.second;
+        table.clear_table_non_atomic();
+
+        const OverheadWindow& o = last_overhead;
+        std::vector<GovernorChange> changes =
+            governor->update(dev_events, o.bpf_ns, o.cpu_ns, streamed, o.wall_s);
+        if (changes.empty()) return;
+
+        auto ctl = bpf->get_hash_table<uint32_t, TraceCtl>("trace_ctl");
+        for (const GovernorChange& c : changes) {
+            if (c.to == TRACE_FULL) {
+                ctl.remove_value(c.dev);
+            } else {
+                TraceCtl v = {(uint32_t)c.to, (1u << GOV_SAMPLE_SHIFT) - 1};
+                ctl.update_value(c.dev, v);
+            }
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3)
+                << "Governor: dev " << devt_name(c.dev) << " " << TRACE_MODE_NAMES[c.from]
+                << " -> " << TRACE_MODE_NAMES[c.to] << " (cost "
+                << 100.0 * (o.bpf_ns + o.cpu_ns) / 1e9 / std::max(o.wall_s, 1e-9) /
+                       sysconf(_SC_NPROCESSORS_ONLN)
+                << "% of host CPU, budget " << governor->budget_pct() << "%)";
+            log_msg(oss.str(), c.to > c.from ? LOG_WARNING : LOG_INFO);
+        }
+    }
+
+    // Curva de fallos por reuso para no hacer prefetch sobre una caché saturada
+    void enable_mrc() {
+        mrc = new ShardsMRC();
+        log_msg("Miss ratio curve enabled (SHARDS, " + std::to_string(mrc->extent_bytes() >> 10) +
+                " KB extents, max " + std::to_string(MRC_MAX_SAMPLES) + " samples)", LOG_INFO);
+    }
+
+    // Una línea JSON por ventana con características, decisión y métricas opcionales
+    /**
+     * Marca cada ventana en su paso por el colector y el daemon y agrega la
+     * latencia por etapa; con chrome_path no vacío vuelca además las
+     * ventanas como traza de Chrome/Perfetto.
+     */
+    bool enable_latency_trace(const std::string& chrome_path) {
+        trace_latency = true;
+        if (!chrome_path.empty()) {
+            chrome_trace = new ChromeTraceWriter();
+            if (!chrome_trace->open(chrome_path)) {
+                log_msg("Cannot open Chrome trace output " + chrome_path + ": " + strerror(errno),
+                        LOG_ERR);
+                return false;
+            }
+            log_msg("Writing window latency trace to " + chrome_path, LOG_INFO);
+        }
+        log_msg("Window latency breakdown enabled", LOG_INFO);
+        return true;
+    }
+
+    /**
+     * Modo captura: escribe cada ventana como fila del dataset consolidado
+     * en lugar de predecir y tocar read_ahead_kb. La etiqueta es label o,
+     * con label_sock, la que envíe el generador de carga.
+     */
+    bool enable_capture(const std::string& path, const std::string& label,
+                        const std::string& label_sock, const std::string& run_id) {
+        capture = new DatasetWriter();
+        if (!capture->open(path)) {
+            log_msg("Cannot open capture output " + path + ": " + strerror(errno), LOG_ERR);
+            return false;
+        }
+        labels.set(label, run_id.empty() ? device + "_" + std::to_string(time(nullptr)) : run_id);
+        if (!label_sock.empty() && !labels.listen(label_sock)) {
+            log_msg("Cannot bind label socket " + label_sock + ": " + strerror(errno), LOG_ERR);
+            return false;
+        }
+        log_msg("Capture mode: writing labelled windows to " + path +
+                (label_sock.empty() ? " (label " + label + ")" : " (labels from " + label_sock + ")") +
+                "; read_ahead_kb is not modified", LOG_INFO);
+        return true;
+    }
+
+    void capture_window(double window_s, const float* f, uint64_t events) {
+        std::string label = labels.window_label();
+        if (label.empty()) {
+            dropped_rows++;
+            return;
+        }
+        uint64_t issued = 0;
+        for (int i = 0; i < BLOCK_OP_COUNT; i++) issued += ops.reqs[i];
+        uint64_t now = predict_monotonic_ns();
+        if (!capture_start_ns) capture_start_ns = window_open_ns;
+        CaptureRow r = {labels.current_run(), label, window_id,
+                        (window_open_ns - capture_start_ns) / 1e9, (now - capture_start_ns) / 1e9,
+                        window_open_ns, events, issued, window_completes,
+                        track_distinct ? distinct_sectors : -1.0,
+                        &stream_stats(model_stream), f, window_s, -1.0, -1.0};
+        if (residency && last_residency.valid) {
+            r.cached_fraction = last_residency.cached_fraction;
+            r.recently_evicted = (double)last_residency.recently_evicted;
+        }
+        capture->write(r);
+        captured_rows++;
+    }
+
+    // Cierra la traza de la ventana: histogramas y, si hay, traza de Chrome
+    void finish_window_trace() {
+        if (!trace_latency || !wtrace.ts[TP_INGEST_CLOSE]) return;
+        latency.add(wtrace);
+        if (chrome_trace) chrome_trace->write(wtrace);
+    }
+
+    bool enable_metrics(const std::string& path) {
+        metrics_fp = (path == "-") ? stdout : fopen(path.c_str(), "a");
+        if (!metrics_fp) {
+            log_msg("Cannot open metrics output " + path + ": " + strerror(errno), LOG_ERR);
+            return false;
+        }
+        log_msg("Writing per-window metrics to " + path, LOG_INFO);
+        return true;
+    }
+
+    // Estima sectores y extents distintos por ventana; llamar antes de init()
+    void enable_distinct_tracking() {
+        track_distinct = true;
+        bpf_cflags.push_back("-DTRACK_DISTINCT");
+        bpf_cflags.push_back("-DHLL_PRECISION=" + std::to_string(HLL_PRECISION));
+        bpf_cflags.push_back("-DHLL_REGISTERS=" + std::to_string(HLL_REGISTERS));
+        bpf_cflags.push_back("-DHLL_EXTENT_SHIFT=" + std::to_string(HLL_EXTENT_SHIFT));
+        log_msg("Distinct sector/extent estimation enabled (HyperLogLog, " +
+                std::to_string(HLL_REGISTERS) + " registers)", LOG_INFO);
+    }
+
+    // Sigue los k emisores (proceso + cgroup) con más bytes; llamar antes de init()
+    void enable_tenant_tracking(int k) {
+        top_tenants = k;
+        tenant_tracker = new SpaceSaving<TenantKey, TenantKeyHash>((size_t)k * TENANT_TRACK_FACTOR);
+        bpf_cflags.push_back("-DTRACK_TENANTS");
+        bpf_cflags.push_back("-DTENANT_MAP_SIZE=" + std::to_string(TENANT_MAP_SIZE));
+        log_msg("Tenant tracking enabled (top " + std::to_string(k) + ", BPF LRU map of " +
+                std::to_string(TENANT_MAP_SIZE) + " entries)", LOG_INFO);
+    }
+
+    // Calcula en paralelo características para varios tamaños de ventana
+    bool enable_multi_resolution(const std::vector<int>& resolutions, const std::string& out_path) {
+        features_fp = open_features_csv(out_path);
+        if (!features_fp) return false;
+        FILE* fp = features_fp;
+        multi = new MultiResolutionExtractor(resolutions, jump_threshold,
+            [fp](int wms, uint64_t idx, uint64_t ts, const WindowAggregate& agg, const float* f) {
+                write_features_csv_row(fp, wms, idx, ts, agg, f);
+            });
+        log_msg("Multi-resolution features enabled (sub-window " +
+                std::to_string(multi->sub_window_ms()) + " ms) -> " + out_path, LOG_INFO);
+        return true;
+    }
+
+    // Graba los eventos crudos para poder re-procesarlos con --replay
+    bool enable_recording(const std::string& path) {
+        record_fp = fopen(path.c_str(), "wb");
+        if (!record_fp || !write_event_file_header(record_fp)) {
+            log_msg("Cannot open event recording " + path + ": " + strerror(errno), LOG_ERR);
+            return false;
+        }
+        log_msg("Recording raw events to " + path, LOG_INFO);
+        return true;
+    }
+
+    /**
+     * Compila el plan de características del bundle del daemon (clave
+     * "features" y "stream", ver feature_plan.h); llamar antes de init().
+     */
+    bool enable_feature_plan(const std::string& bundle_path) {
+        ModelBundle bundle;
+        if (!bundle.open(bundle_path)) {
+            log_msg("Cannot read model bundle " + bundle_path, LOG_ERR);
+            return false;
+        }
+        std::string err;
+        if (!plan.from_bundle(bundle, &err)) {
+            log_msg("Invalid feature plan in " + bundle_path + ": " + err, LOG_ERR);
+            return false;
+        }
+        have_plan = true;
+        model_stream = (uint32_t)parse_predict_stream(bundle.get("stream", "all"));
+        return true;
+    }
+
+    // Completa el plan con lo que piden las salidas activas y lo pasa a BPF
+    void finalize_feature_plan() {
+        if (!have_plan) return;
+        if (metrics_fp) {
+            for (int i = 0; i < NUM_FEATURES; i++) plan.need_feature(i);
+            plan.need_stream(PREDICT_STREAM_READ);
+            plan.need_stream(PREDICT_STREAM_WRITE);
+        }
+        if (capture)
+            for (int i = 0; i < NUM_FEATURES; i++) plan.need_feature(i);
+        if (multi || record_fp) plan.timestamps = true;
+        std::vector<std::string> flags = plan.bpf_cflags();
+        bpf_cflags.insert(bpf_cflags.end(), flags.begin(), flags.end());
+        log_msg("Feature plan: " + plan.describe(), LOG_INFO);
+    }
+
     bool init() {
+        finalize_feature_plan();
         try {
+            if (stack.stacked()) {
+                std::ostringstream oss;
+                oss << "Stacked device: " << stack.top << " over";
+                for (const std::string& m : stack.members) oss << " " << m;
+                oss << " (bio-level events on " << stack.top << ", member requests ignored)";
+                log_msg(oss.str(), LOG_INFO);
+                bpf_cflags.push_back("-DSTACK_TOP_DEV=" + std::to_string(stack.top_dev));
+                bpf_cflags.push_back("-DSTACK_MAX_MEMBERS=" + std::to_string(STACK_MAX_MEMBERS));
+            }
+            log_msg("Readahead actuation on " + stack.readahead_path(), LOG_INFO);
+
             bpf = new ebpf::BPF();
-            auto r1 = bpf->init(BPF_PROGRAM);
+            auto r1 = bpf->init(BPF_PROGRAM, bpf_cflags);
             if (r1.code() != 0) {
                 log_msg(std::string("BPF init error: ") + r1.msg(), LOG_ERR);
                 return false;
             }
 
+            if (stack.stacked()) {
+                auto members = bpf->get_hash_table<uint32_t, uint8_t>("stack_members");
+                for (uint32_t d : stack.member_devs) members.update_value(d, 1);
+            }
+
             auto r2 = bpf->open_perf_buffer("events", event_callback, nullptr, this, 128);
             if (r2.code() != 0) {
                 log_msg(std::string("perf buffer error: ") + r2.msg(), LOG_ERR);
                 return false;
             }
 
+            if (residency || track_file_pattern) {
+                auto r3 = bpf->attach_kprobe("filemap_read", "trace_file_read");
+                if (r3.code() != 0)
+                    r3 = bpf->attach_kprobe("generic_file_read_iter", "trace_file_read");
+                if (r3.code() != 0) {
+                    log_msg(std::string("Cannot attach file read kprobe: ") + r3.msg(), LOG_ERR);
+                    return false;
+                }
+            }
+
+            if (track_origin) {
+                int attached = 0;
+                for (const char* fn : DIO_ENTRY_POINTS) {
+                    if (bpf->attach_kprobe(fn, "dio_enter").code() != 0) continue;
+                    if (bpf->attach_kprobe(fn, "dio_return", 0, BPF_PROBE_RETURN).code() != 0) {
+                        log_msg(std::string("Cannot attach kretprobe to ") + fn, LOG_WARNING);
+                        continue;
+                    }
+                    attached++;
+                }
+                if (attached == 0) {
+                    // Sin marca de direct I/O todo parecería con caché: mejor no suprimir nada
+                    log_msg("No direct I/O entry point found, direct I/O detection disabled",
+                            LOG_WARNING);
+                    track_origin = false;
+                    suppress_direct = false;
+                } else {
+                    log_msg("Direct I/O detection enabled (" + std::to_string(attached) +
+                            " entry points)", LOG_INFO);
+                }
+            }
+
+            if (overhead) register_overhead_programs();
+
+            current_ra = read_readahead();
+
             log_msg("eBPF initialized successfully (capturing all block devices)", LOG_INFO);
             log_msg("Attached to tracepoints: block:block_rq_complete and block:block_rq_issue", LOG_INFO);
             return true;
@@ -373,29 +1993,103 @@ public:
         double win_s = (double)window_ms / 1000.0;
         int window_count = 0;
 
+        // El cierre de ventanas lo marca la rueda de timers; hoy hay un solo
+        // flujo (el dispositivo) y los flujos por cgroup/archivo se añaden aquí
+        WindowScheduler windows;
+        if (!windows.open()) {
+            log_msg(std::string("timerfd_create failed: ") + strerror(errno), LOG_ERR);
+            return;
+        }
+        uint32_t device_stream = windows.add_stream();
+        uint64_t window_ns = (uint64_t)window_ms * 1000000ULL;
+        uint64_t deadline = predict_monotonic_ns();
+
         while (running) {
-            auto window_start = std::chrono::steady_clock::now();
-            auto window_end = window_start + std::chrono::milliseconds(window_ms);
+            // Plazos sobre una rejilla fija: el procesado de la ventana no la desplaza
+            uint64_t now = predict_monotonic_ns();
+            deadline += window_ns;
+            if (deadline <= now) {
+                log_msg("Window processing overran the window, restarting the schedule", LOG_WARNING);
+                deadline = now + window_ns;
+            }
+            windows.schedule(device_stream, deadline);
             stats.reset();
+            stats_read.reset();
+            stats_write.reset();
+            ops.reset();
+            window_id = window_count + 1;
+            USDT_PROBE2(readahead, window_open, device_id, window_id);
+            window_open_ns = predict_monotonic_ns();
+            window_completes = 0;
             
             uint64_t events_at_start = total_events_received;
             
-            // Poll más agresivamente
-            while (std::chrono::steady_clock::now() < window_end && running) {
-                bpf->poll_perf_buffer("events", 50);  // timeout reducido a 50ms
+            // Poll hasta el vencimiento (como mucho 50 ms para atender señales)
+            bool due = false;
+            while (!due && running) {
+                bpf->poll_perf_buffer("events", windows.timeout_ms(50));
+                for (uint32_t s : windows.expired())
+                    if (s == device_stream) due = true;
             }
             
             window_count++;
             uint64_t events_in_window = total_events_received - events_at_start;
+            USDT_PROBE4(readahead, window_close, device_id, window_id, events_in_window, stats.reqs);
+            if (trace_latency) {
+                wtrace = WindowTrace();
+                wtrace.id = ((uint64_t)getpid() << 32) | (window_id & 0xFFFFFFFFu);
+                wtrace.window = window_id;
+                wtrace.device_id = device_id;
+                wtrace.mark(TP_INGEST_CLOSE);
+            }
 
             // Diagnóstico cada ventana
             log_msg("=== Window #" + std::to_string(window_count) + " ===", LOG_INFO);
             log_msg("Events in window: " + std::to_string(events_in_window), LOG_INFO);
             log_msg("Total events so far: " + std::to_string(total_events_received), LOG_INFO);
             
+            // La presión se muestrea en todas las ventanas para que los deltas no se acumulen
+            if (pressure_guard) sample_pressure();
+            // Y los contadores por archivo: las lecturas servidas desde la caché no
+            // generan I/O de bloque, así que se muestrean también sin peticiones
+            if (residency) sample_residency();
+            if (track_file_pattern) sample_file_pattern();
+            if (track_origin) sample_origin();
+
+            ops_total.merge(ops);
+            if (overhead) {
+                uint64_t ios = 0;
+                for (int i = 0; i < BLOCK_OP_COUNT; i++) ios += ops.reqs[i];
+                sample_overhead(ios);
+            }
+            if (governor) {
+                merge_kernel_aggregates();
+                govern(events_in_window);
+            }
+            uint64_t non_data = ops.reqs[BLOCK_OP_DISCARD] + ops.reqs[BLOCK_OP_SECURE_ERASE] +
+                                ops.reqs[BLOCK_OP_FLUSH] + ops.reqs[BLOCK_OP_OTHER];
+            if (non_data > 0 || ops.rahead > 0)
+                log_msg("Ops in window: " + ops.summary(), LOG_INFO);
+
             // Verificar contador del kernel cada 5 ventanas
             if (window_count % 5 == 0) {
                 check_kernel_events();
+                log_prediction_counters();
+                log_msg("Ops total: " + ops_total.summary(), LOG_INFO);
+                if (trace_latency && latency.stages[TRACE_STAGE_TOTAL].count())
+                    log_msg("Decision latency: " + latency.summary(), LOG_INFO);
+                if (capture)
+                    log_msg("Capture: " + std::to_string(captured_rows) + " rows, " +
+                            std::to_string(dropped_rows) + " windows dropped (label '" +
+                            labels.current_label() + "')", LOG_INFO);
+                if (overhead) {
+                    std::ostringstream oss;
+                    oss << std::fixed << std::setprecision(2)
+                        << "Overhead total: BPF " << overhead_bpf_total / 1e6 << " ms ("
+                        << (overhead_ios_total ? (double)overhead_bpf_total / overhead_ios_total : 0.0)
+                        << " ns per I/O), collector CPU " << overhead_cpu_total / 1e6 << " ms";
+                    log_msg(oss.str(), LOG_INFO);
+                }
             }
 
             if (stats.reqs == 0) {
@@ -404,29 +2098,120 @@ public:
                 continue;
             }
 
+            if (tenant_tracker) report_tenants();
+            if (track_distinct) report_distinct();
+            if (mrc) evaluate_mrc();
+
             log_msg("Captured " + std::to_string(stats.reqs) + 
                    " requests, " + std::to_string(stats.bytes_acc) + " bytes", LOG_INFO);
 
+            // Sin peticiones del flujo que consume el modelo (p.ej. solo
+            // escrituras con un modelo de lecturas) no hay nada que decidir
+            if (stream_stats(model_stream).reqs == 0) {
+                log_msg(std::string("No ") + PREDICT_STREAM_NAMES[model_stream] +
+                        " requests in this window, keeping read_ahead_kb", LOG_INFO);
+                if (mrc) mrc->decay(MRC_DECAY);
+                continue;
+            }
+
             float feat[5];
+            uint64_t feat_t0 = USDT_START(readahead, features);
             calculate_features(win_s, feat);
+            USDT_PROBE3(readahead, features, device_id, window_id, usdt_since(feat_t0));
+            if (trace_latency) wtrace.mark(TP_FEATURES_DONE);
 
-            int pred = send_to_daemon(feat);
-            if (pred >= 0 && pred < 3) {
-                int ra = READAHEAD_MAP[pred];
-                if (write_readahead(ra)) {
-                    log_msg(std::string("Prediction successful: class=") + CLASS_NAMES[pred] + 
-                            " read_ahead_kb=" + std::to_string(ra), LOG_INFO);
-                } else {
-                    log_msg("Failed to write read_ahead_kb", LOG_WARNING);
+            if (capture) {
+                capture_window(win_s, feat, events_in_window);
+                if (mrc) mrc->decay(MRC_DECAY);
+                continue;
+            }
+
+            bool from_ml = false;
+            int pred = classify_window(feat, &from_ml);
+            int ra = READAHEAD_MAP[pred];
+
+            // El modelo no es fiable fuera de la distribución de entrenamiento
+            bool ood = from_ml && (last_response.flags & PREDICT_RESP_OOD);
+            if (from_ml && (last_response.flags & (PREDICT_RESP_OOD | PREDICT_RESP_DRIFT))) {
+                std::ostringstream oss;
+                oss << "Feature drift: psi=" << std::fixed << std::setprecision(3)
+                    << last_response.drift_score << (ood ? " (out of distribution)" : "");
+                log_msg(oss.str(), ood ? LOG_WARNING : LOG_INFO);
+            }
+            if (ood) {
+                counters.ood_conservative++;
+                ra = CONSERVATIVE_READAHEAD_KB;
+            }
+
+            // No hacer prefetch agresivo en una caché que ya expulsa datos reutilizados
+            bool capped = thrashing && ra > READAHEAD_MAP[2];
+            if (capped) {
+                counters.thrash_capped++;
+                ra = READAHEAD_MAP[2];
+            }
+
+            // Leer en secuencia archivos que ya están en caché no necesita más prefetch
+            if (residency && last_residency.valid && pred == 0 && current_ra >= 0 &&
+                ra > current_ra && last_residency.cached_fraction >= RESIDENCY_CACHED_HIGH) {
+                counters.cached_hold++;
+                log_msg("Keeping read_ahead_kb=" + std::to_string(current_ra) +
+                        ": hot files already cached", LOG_INFO);
+                ra = current_ra;
+            }
+
+            // Tope duro: con presión de memoria el prefetch agrava el incidente
+            if (pressure_guard) {
+                std::string reason;
+                int cap = PressureMonitor::readahead_cap(last_pressure, &reason);
+                if (cap > 0 && ra > cap) {
+                    counters.pressure_capped++;
+                    log_msg("Readahead capped at " + std::to_string(cap) + " KB: " + reason,
+                            LOG_WARNING);
+                    ra = cap;
                 }
+            }
+
+            // Con direct I/O el readahead no hace nada: evitar escrituras inútiles en sysfs
+            double buffered = track_origin ? buffered_read_fraction() : 1.0;
+            if (suppress_direct && buffered < BUFFERED_READ_MIN) {
+                counters.skipped_direct++;
+                std::ostringstream oss;
+                oss << std::fixed << std::setprecision(3)
+                    << "Skipping read_ahead_kb change: buffered reads negligible (fraction="
+                    << buffered << ", class=" << CLASS_NAMES[pred] << ")";
+                log_msg(oss.str(), LOG_INFO);
+                finish_window_trace();
+                if (metrics_fp) write_metrics(window_count, feat, pred, "skipped_direct", current_ra);
+                if (mrc) mrc->decay(MRC_DECAY);
+                continue;
+            }
+
+            bool written = write_readahead(ra);
+            if (trace_latency) {
+                if (written) wtrace.mark(TP_ACTUATION_DONE);
+                finish_window_trace();
+            }
+            if (written) {
+                log_msg(std::string(ood ? "Conservative (OOD)" :
+                                    from_ml ? "Prediction successful" : "Heuristic fallback") +
+                        ": class=" + CLASS_NAMES[pred] +
+                        " read_ahead_kb=" + std::to_string(ra) +
+                        (capped ? " (capped: cache thrashing)" : ""), LOG_INFO);
             } else {
-                log_msg(std::string("No prediction or invalid class returned (pred=") + 
-                       std::to_string(pred) + ")", LOG_WARNING);
+                log_msg("Failed to write read_ahead_kb", LOG_WARNING);
             }
+
+            if (metrics_fp)
+                write_metrics(window_count, feat, pred,
+                              ood ? "ood" : (from_ml ? "ml" : "heuristic"), ra);
+            if (mrc) mrc->decay(MRC_DECAY);
         }
         
         log_msg("Collector stopped. Total events received: " + 
                std::to_string(total_events_received), LOG_INFO);
+        log_prediction_counters();
+        if (trace_latency && latency.stages[TRACE_STAGE_TOTAL].count())
+            log_msg("Decision latency: " + latency.summary(), LOG_INFO);
     }
 
     void stop() { running = false; }
@@ -450,32 +2235,163 @@ int main(int argc, char* argv[]) {
     openlog("ebpf-blocktrace", LOG_PID | LOG_CONS, LOG_USER);
 
     std::string device = DEFAULT_DEVICE;
-    int window_ms = DEFAULT_WINDOW_MS;
+    int window_ms = 0;
+    std::string config_path = DEFAULT_CONFIG_PATH;
     std::string sock = DEFAULT_SOCK_PATH;
+    std::vector<int> resolutions;
+    std::string features_out;
+    std::string record_path;
+    std::string replay_path;
+    int deadline_ms = DEFAULT_DEADLINE_MS;
+    int top_tenants = 0;
+    bool distinct = false;
+    bool use_mrc = false;
+    std::string metrics_out;
+    bool latency_trace = false;
+    std::string capture_out;
+    std::string capture_label;
+    std::string label_sock;
+    std::string run_id;
+    std::string chrome_trace_out;
+    bool use_pressure_guard = true;
+    std::string cgroup_dir;
+    int hot_files = 0;
+    bool always_actuate = false;
+    bool file_pattern = false;
+    bool measure_overhead = false;
+    double overhead_budget = 0.0;
+    std::string bundle_path;
 
     static struct option long_opts[] = {
         {"device", required_argument, 0, 'd'},
         {"window", required_argument, 0, 'w'},
         {"sock", required_argument, 0, 's'},
+        {"resolutions", required_argument, 0, 'r'},
+        {"features-out", required_argument, 0, 'o'},
+        {"record", required_argument, 0, 'R'},
+        {"replay", required_argument, 0, 'P'},
+        {"config", required_argument, 0, 'c'},
+        {"deadline-ms", required_argument, 0, 'D'},
+        {"top-tenants", required_argument, 0, 'T'},
+        {"distinct", no_argument, 0, 'U'},
+        {"mrc", no_argument, 0, 'M'},
+        {"metrics-out", required_argument, 0, 'm'},
+        {"no-pressure-guard", no_argument, 0, 'N'},
+        {"cgroup", required_argument, 0, 'g'},
+        {"hot-files", required_argument, 0, 'F'},
+        {"always-actuate", no_argument, 0, 'A'},
+        {"file-pattern", no_argument, 0, 'S'},
+        {"overhead", no_argument, 0, 'O'},
+        {"latency-trace", no_argument, 0, 'L'},
+        {"capture", required_argument, 0, 'K'},
+        {"label", required_argument, 0, 'l'},
+        {"label-socket", required_argument, 0, 'Y'},
+        {"run-id", required_argument, 0, 'I'},
+        {"chrome-trace", required_argument, 0, 'C'},
+        {"overhead-budget", required_argument, 0, 'B'},
+        {"bundle", required_argument, 0, 'b'},
         {"help", no_argument, 0, 'h'},
         {0,0,0,0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "d:w:s:h", long_opts, nullptr)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:w:s:r:o:c:h", long_opts, nullptr)) != -1) {
         if (opt == 'd') device = optarg;
         else if (opt == 'w') window_ms = atoi(optarg);
         else if (opt == 's') sock = optarg;
+        else if (opt == 'r') resolutions = parse_window_list(optarg);
+        else if (opt == 'o') features_out = optarg;
+        else if (opt == 'R') record_path = optarg;
+        else if (opt == 'P') replay_path = optarg;
+        else if (opt == 'c') config_path = optarg;
+        else if (opt == 'D') deadline_ms = atoi(optarg);
+        else if (opt == 'T') top_tenants = atoi(optarg);
+        else if (opt == 'U') distinct = true;
+        else if (opt == 'M') use_mrc = true;
+        else if (opt == 'm') metrics_out = optarg;
+        else if (opt == 'N') use_pressure_guard = false;
+        else if (opt == 'g') cgroup_dir = optarg;
+        else if (opt == 'F') hot_files = atoi(optarg);
+        else if (opt == 'A') always_actuate = true;
+        else if (opt == 'S') file_pattern = true;
+        else if (opt == 'O') measure_overhead = true;
+        else if (opt == 'L') latency_trace = true;
+        else if (opt == 'K') capture_out = optarg;
+        else if (opt == 'l') capture_label = optarg;
+        else if (opt == 'Y') label_sock = optarg;
+        else if (opt == 'I') run_id = optarg;
+        else if (opt == 'C') chrome_trace_out = optarg;
+        else if (opt == 'B') overhead_budget = atof(optarg);
+        else if (opt == 'b') bundle_path = optarg;
         else if (opt == 'h') {
             std::cout << "Usage: " << argv[0] << " [options]\n"
-                      << "  -d, --device <dev>   Block device (default: sda2)\n"
-                      << "  -w, --window <ms>    Window size in ms (default: 2500)\n"
-                      << "  -s, --sock <path>    Socket path (default: /tmp/ml_predictor.sock)\n"
-                      << "  -h, --help           Show this help\n";
+                      << "  -d, --device <dev>        Block device (default: sda2)\n"
+                      << "  -w, --window <ms>         Window size in ms (default: config or 2500)\n"
+                      << "  -s, --sock <path>         Socket path (default: /tmp/ml_predictor.sock)\n"
+                      << "  -r, --resolutions <list>  Extra window sizes in ms computed in one pass\n"
+                      << "                            (e.g. 100,250,1000,2500,5000)\n"
+                      << "  -o, --features-out <csv>  Per-resolution feature rows (default: stdout)\n"
+                      << "      --record <file>       Record raw block events for later replay\n"
+                      << "      --replay <file>       Compute features from a recording and exit\n"
+                      << "  -c, --config <file>       Per device-class parameters written by window_tuner\n"
+                      << "                            (default: " DEFAULT_CONFIG_PATH ")\n"
+                      << "      --deadline-ms <ms>    Max wait for the predictor before using the\n"
+                      << "                            built-in heuristic (default: 50)\n"
+                      << "      --top-tenants <k>     Log per-window stats of the k processes/cgroups\n"
+                      << "                            issuing the most bytes (default: off)\n"
+                      << "      --distinct            Estimate distinct sectors and 1 MB extents per\n"
+                      << "                            window with HyperLogLog in BPF\n"
+                      << "      --mrc                 Estimate the miss ratio curve (SHARDS) and cap\n"
+                      << "                            readahead while the page cache is thrashing\n"
+                      << "      --metrics-out <file>  Append one JSON line per window ('-' = stdout)\n"
+                      << "      --cgroup <dir>        Also watch io/memory.pressure of this cgroup v2\n"
+                      << "      --no-pressure-guard   Do not cap readahead on memory/IO pressure\n"
+                      << "      --hot-files <k>       Sample page cache residency (cachestat) of the k\n"
+                      << "                            most read files; no readahead increase for\n"
+                      << "                            sequential reads of cached files\n"
+                      << "      --always-actuate      Write read_ahead_kb even when reads are direct I/O\n"
+                      << "      --file-pattern        Detect sequential reads on file offsets (VFS);\n"
+                      << "                            used instead of the block heuristic as fallback\n"
+                      << "      --overhead            Measure run time of each BPF program (ns per\n"
+                      << "                            event) and collector CPU per window\n"
+                      << "      --overhead-budget <pct>  Keep tracing cost under pct % of host CPU by\n"
+                      << "                            switching each device between full, sampled\n"
+                      << "                            and in-kernel aggregate modes (implies --overhead)\n"
+                      << "      --latency-trace       Break down each window's decision latency by stage\n"
+                      << "                            (features, IPC, inference, actuation)\n"
+                      << "      --chrome-trace <file>  Also write the stages as a Chrome/Perfetto trace\n"
+                      << "                            JSON (implies --latency-trace)\n"
+                      << "      --capture <csv>       Capture mode: append one labelled row per window\n"
+                      << "                            in the consolidated dataset format, without\n"
+                      << "                            predicting or changing read_ahead_kb\n"
+                      << "      --label <class>       Label of the captured windows\n"
+                      << "      --label-socket <path>  Take labels from a datagram socket instead\n"
+                      << "                            (\"label <class>\", \"run <id>\"; see io_workload)\n"
+                      << "      --run-id <id>         run_id column (default: <device>_<unix time>)\n"
+                      << "      --bundle <path>       Predictor model bundle: compute only the\n"
+                      << "                            aggregates its features and stream need\n"
+                      << "  -h, --help                Show this help\n";
             return 0;
         }
     }
 
+    // Parámetros por clase de dispositivo (la línea de comandos tiene prioridad)
+    CollectorConfig config;
+    bool have_config = config.load(config_path);
+    std::string dev_class = detect_device_class(device);
+    if (window_ms <= 0)
+        window_ms = (int)config.get_int(dev_class, "window_ms", DEFAULT_WINDOW_MS);
+    uint64_t jump_threshold = (uint64_t)config.get_int(dev_class, "jump_threshold_bytes",
+                                                       JUMP_THRESHOLD_BYTES);
+    if (have_config) {
+        log_msg("Loaded " + config_path + " (device class " + dev_class + ")", LOG_INFO);
+    }
+
+    if (!replay_path.empty()) {
+        if (resolutions.empty()) resolutions.push_back(window_ms);
+        return replay_events(replay_path, resolutions, jump_threshold, features_out);
+    }
+
     if (geteuid() != 0) {
         log_msg("Must run as root", LOG_ERR);
         std::cerr << "ERROR: Must run as root\n";
@@ -484,14 +2400,65 @@ int main(int argc, char* argv[]) {
 
     log_msg("Starting ebpf-blocktrace with device=" + device + 
             " window_ms=" + std::to_string(window_ms) + 
+            " jump_threshold=" + std::to_string(jump_threshold) +
             " sock=" + sock, LOG_INFO);
 
-    EBPFBlockTrace collector(device, window_ms, sock);
+    EBPFBlockTrace collector(device, window_ms, sock, jump_threshold);
+    collector.set_deadline_ms(deadline_ms);
+    if (top_tenants > 0) collector.enable_tenant_tracking(top_tenants);
+    if (distinct) collector.enable_distinct_tracking();
+    if (use_mrc) collector.enable_mrc();
+    if (use_pressure_guard) collector.enable_pressure_guard(cgroup_dir);
+    collector.enable_origin_tracking(!always_actuate);
+    if (file_pattern) collector.enable_file_pattern();
+    if ((measure_overhead || overhead_budget > 0.0) && !collector.enable_overhead()) {
+        closelog();
+        return 1;
+    }
+    if (overhead_budget > 0.0) collector.enable_governor(overhead_budget);
+    if (hot_files > 0 && !collector.enable_file_residency(hot_files)) {
+        closelog();
+        return 1;
+    }
+    if ((latency_trace || !chrome_trace_out.empty()) &&
+        !collector.enable_latency_trace(chrome_trace_out)) {
+        closelog();
+        return 1;
+    }
+    if (!capture_out.empty()) {
+        if (capture_label.empty() && label_sock.empty()) {
+            std::cerr << "ERROR: --capture needs --label or --label-socket\n";
+            closelog();
+            return 1;
+        }
+        if (!collector.enable_capture(capture_out, capture_label, label_sock, run_id)) {
+            closelog();
+            return 1;
+        }
+    }
+    if (!metrics_out.empty() && !collector.enable_metrics(metrics_out)) {
+        closelog();
+        return 1;
+    }
     g_ptr = &collector;
 
     signal(SIGINT, handler);
     signal(SIGTERM, handler);
 
+    if (!resolutions.empty() && !collector.enable_multi_resolution(resolutions, features_out)) {
+        closelog();
+        return 1;
+    }
+    if (!record_path.empty() && !collector.enable_recording(record_path)) {
+        closelog();
+        return 1;
+    }
+
+    if (!bundle_path.empty() && !collector.enable_feature_plan(bundle_path)) {
+        closelog();
+        return 1;
+    }
+
     if (!collector.init()) {
         log_msg("Initialization failed", LOG_ERR);
         std::cerr << "ERROR: Initialization failed. Check syslog for details.\n";
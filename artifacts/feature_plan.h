@@ -0,0 +1,172 @@
+/*
+ * feature_plan.h
+ *
+ * Plan de características: qué agregados calcula el colector según lo que
+ * consume el modelo.
+ *
+ * El bundle declara las características de su modelo (clave "features",
+ * nombres de FEATURE_NAMES separados por comas; sin ella, todas) y el flujo
+ * ("stream"). Al cargar, el colector compila el plan:
+ *
+ *   - reductores por evento que piden esas características (FEATURE_REDUCERS),
+ *     más los del respaldo heurístico, que tiene que poder decidir sin daemon;
+ *   - agregados por flujo (all/read/write): "all", que usa el propio
+ *     colector (conteos, presupuesto, logs), y el del modelo, salvo que
+ *     alguna salida (--metrics-out) los vuelque todos;
+ *   - marca de tiempo por evento, solo si la leen --features-out o --record.
+ *
+ * En BPF el plan entra como constantes de carga (-DPLAN_*): el compilador
+ * elimina las actualizaciones de mapas que no se usan. En el espacio de
+ * usuario decide qué agregados se actualizan en process_event().
+ *
+ * El daemon aplica el mismo "features": las no declaradas se normalizan a 0
+ * y no se vigilan para drift, así que enviarlas sin calcular no altera la
+ * predicción.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "model_bundle.h"
+#include "predictor_protocol.h"
+#include "window_features.h"
+
+// Reductores por evento de WindowAggregate (y de kagg en BPF)
+#define FP_REDUCE_COUNT     0x1u   // reqs
+#define FP_REDUCE_BYTES     0x2u   // bytes_acc
+#define FP_REDUCE_JUMPS     0x4u   // último sector y saltos
+#define FP_REDUCE_DISTANCE  0x8u   // suma de distancias entre peticiones
+#define FP_REDUCE_ALL       0xFu
+
+static const uint32_t FEATURE_REDUCERS[NUM_FEATURES] = {
+    FP_REDUCE_COUNT | FP_REDUCE_JUMPS | FP_REDUCE_DISTANCE,   // avg_distance_bytes
+    FP_REDUCE_COUNT | FP_REDUCE_JUMPS,                        // jump_ratio
+    FP_REDUCE_COUNT | FP_REDUCE_BYTES,                        // avg_io_bytes
+    FP_REDUCE_COUNT | FP_REDUCE_JUMPS,                        // seq_ratio
+    FP_REDUCE_COUNT                                           // iops
+};
+
+// Características que lee heuristic_classify() (predictor_client.h)
+static const int FALLBACK_FEATURES[] = {2, 3};
+
+#define FP_ALL_FEATURES  ((1u << NUM_FEATURES) - 1)
+#define FP_ALL_STREAMS   0x7u      // bit por PREDICT_STREAM_*
+
+struct FeaturePlan {
+    uint32_t features;     // bit por característica de FEATURE_NAMES
+    uint32_t reducers;     // FP_REDUCE_*
+    uint32_t streams;      // bit por PREDICT_STREAM_*
+    bool timestamps;       // ts de cada evento (bpf_ktime_get_ns)
+
+    FeaturePlan() : features(FP_ALL_FEATURES), reducers(FP_REDUCE_ALL), streams(FP_ALL_STREAMS),
+                    timestamps(true) {}
+
+    bool wants_feature(int i) const { return features & (1u << i); }
+    bool wants_stream(uint32_t s) const { return streams & (1u << s); }
+    bool distance() const { return reducers & FP_REDUCE_DISTANCE; }
+
+    void need_feature(int i) {
+        features |= 1u << i;
+        reducers |= FEATURE_REDUCERS[i];
+    }
+
+    void need_stream(uint32_t s) { streams |= 1u << s; }
+
+    /**
+     * "avg_io_bytes,seq_ratio" -> máscara de características. Vacío = todas.
+     * Devuelve false con err si hay un nombre desconocido.
+     */
+    static bool parse_features(const std::string& list, uint32_t* mask, std::string* err) {
+        if (list.empty()) {
+            *mask = FP_ALL_FEATURES;
+            return true;
+        }
+        *mask = 0;
+        std::stringstream ss(list);
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            size_t b = name.find_first_not_of(" \t");
+            size_t e = name.find_last_not_of(" \t");
+            if (b == std::string::npos) continue;
+            name = name.substr(b, e - b + 1);
+            int idx = -1;
+            for (int i = 0; i < NUM_FEATURES; i++)
+                if (name == FEATURE_NAMES[i]) idx = i;
+            if (idx < 0) {
+                if (err) *err = "unknown feature '" + name + "'";
+                return false;
+            }
+            *mask |= 1u << idx;
+        }
+        if (*mask == 0) *mask = FP_ALL_FEATURES;
+        return true;
+    }
+
+    /**
+     * Plan mínimo para el modelo del bundle: sus características y su
+     * flujo, más lo que necesita el respaldo heurístico. Las salidas que
+     * vuelcan más (métricas, captura, eventos) se añaden después con
+     * need_feature()/need_stream().
+     */
+    bool from_bundle(const ModelBundle& bundle, std::string* err) {
+        uint32_t mask;
+        if (!parse_features(bundle.get("features"), &mask, err)) return false;
+        int s = parse_predict_stream(bundle.get("stream", "all"));
+        if (s < 0) {
+            if (err) *err = "unknown stream '" + bundle.get("stream") + "'";
+            return false;
+        }
+        features = 0;
+        reducers = 0;
+        streams = 0;
+        timestamps = false;
+        for (int i = 0; i < NUM_FEATURES; i++)
+            if (mask & (1u << i)) need_feature(i);
+        uint32_t model_features = features;
+        for (int i : FALLBACK_FEATURES) need_feature(i);
+        features = model_features;     // el respaldo solo añade reductores
+        need_stream(PREDICT_STREAM_ALL);
+        need_stream((uint32_t)s);
+        return true;
+    }
+
+    // Constantes de carga del programa BPF
+    std::vector<std::string> bpf_cflags() const {
+        return {"-DPLAN_STREAMS=" + std::to_string(streams),
+                "-DPLAN_DISTANCE=" + std::string(distance() ? "1" : "0"),
+                "-DPLAN_TIMESTAMPS=" + std::string(timestamps ? "1" : "0")};
+    }
+
+    // "features=seq_ratio,avg_io_bytes streams=all reducers=count,bytes,jumps timestamps=off"
+    std::string describe() const {
+        static const char* const REDUCER_NAMES[] = {"count", "bytes", "jumps", "distance"};
+        std::ostringstream oss;
+        oss << "features=";
+        bool first = true;
+        for (int i = 0; i < NUM_FEATURES; i++) {
+            if (!wants_feature(i)) continue;
+            oss << (first ? "" : ",") << FEATURE_NAMES[i];
+            first = false;
+        }
+        oss << " streams=";
+        first = true;
+        for (uint32_t s = 0; s < 3; s++) {
+            if (!wants_stream(s)) continue;
+            oss << (first ? "" : ",") << PREDICT_STREAM_NAMES[s];
+            first = false;
+        }
+        oss << " reducers=";
+        first = true;
+        for (int r = 0; r < 4; r++) {
+            if (!(reducers & (1u << r))) continue;
+            oss << (first ? "" : ",") << REDUCER_NAMES[r];
+            first = false;
+        }
+        oss << " timestamps=" << (timestamps ? "on" : "off");
+        return oss.str();
+    }
+};
@@ -0,0 +1,86 @@
+/*
+ * file_pattern.h
+ *
+ * Secuencialidad por archivo medida sobre offsets de archivo (capa VFS /
+ * filemap), no sobre sectores.
+ *
+ * El orden de los sectores que ve la capa de bloque lo deforman la
+ * asignación del sistema de archivos, el planificador de I/O y las fusiones
+ * de peticiones; el readahead, en cambio, trabaja sobre offsets del
+ * archivo. El programa BPF del colector (mismo kprobe que file_residency.h)
+ * guarda por (dev, inode) el offset donde terminó la última lectura y
+ * cuenta una lectura como secuencial si empieza a menos de FILE_SEQ_GAP_BYTES
+ * de ahí. Los contadores son acumulados por CPU; aquí se calcula el delta de
+ * cada ventana y la clase correspondiente.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#define FILE_SEQ_GAP_BYTES 65536       // hueco máximo entre lecturas "secuenciales"
+#define FILE_PATTERN_MIN_READS 32      // lecturas (no primeras) para fiarse de la clase
+#define FILE_SEQ_RATIO_HIGH 0.80
+#define FILE_SEQ_RATIO_LOW 0.30
+
+// Índices del array per-CPU file_pattern del programa BPF
+enum FilePatternCounter {
+    FPAT_READS = 0,
+    FPAT_SEQ_READS,
+    FPAT_FIRST_READS,      // primera lectura de un archivo (sin offset previo)
+    FPAT_BYTES,
+    FPAT_SEQ_BYTES,
+    FPAT_GAP_SUM,          // suma de |offset - fin anterior| de las no secuenciales
+    FPAT_COUNTERS
+};
+
+struct FilePatternWindow {
+    uint64_t c[FPAT_COUNTERS];
+
+    FilePatternWindow() : c() {}
+
+    // Delta entre los totales actuales y los de la ventana anterior (que se actualizan)
+    static FilePatternWindow delta(const uint64_t* now, uint64_t* prev) {
+        FilePatternWindow w;
+        for (int i = 0; i < FPAT_COUNTERS; i++) {
+            w.c[i] = now[i] >= prev[i] ? now[i] - prev[i] : 0;
+            prev[i] = now[i];
+        }
+        return w;
+    }
+
+    uint64_t reads() const { return c[FPAT_READS]; }
+
+    // Lecturas con offset previo conocido: las que se pueden clasificar
+    uint64_t judged() const {
+        return c[FPAT_READS] > c[FPAT_FIRST_READS] ? c[FPAT_READS] - c[FPAT_FIRST_READS] : 0;
+    }
+
+    bool valid() const { return judged() >= FILE_PATTERN_MIN_READS; }
+
+    double seq_ratio() const {
+        return judged() ? (double)c[FPAT_SEQ_READS] / judged() : 0.0;
+    }
+
+    double avg_read_bytes() const {
+        return c[FPAT_READS] ? (double)c[FPAT_BYTES] / c[FPAT_READS] : 0.0;
+    }
+
+    double avg_gap_bytes() const {
+        uint64_t jumps = judged() - c[FPAT_SEQ_READS];
+        return jumps ? (double)c[FPAT_GAP_SUM] / jumps : 0.0;
+    }
+
+    /**
+     * 0=sequential, 1=random, 2=mixed (mismo mapeo que el modelo), o -1 sin
+     * lecturas suficientes. El tamaño de lectura no cuenta: una aplicación
+     * que lee 4 KB seguidos es justo el caso que el readahead acelera.
+     */
+    int classify() const {
+        if (!valid()) return -1;
+        double r = seq_ratio();
+        if (r >= FILE_SEQ_RATIO_HIGH) return 0;
+        if (r <= FILE_SEQ_RATIO_LOW) return 1;
+        return 2;
+    }
+};
@@ -0,0 +1,187 @@
+/*
+ * file_residency.h
+ *
+ * Residencia en la caché de páginas de los archivos más leídos.
+ *
+ * El programa BPF del colector (kprobe en filemap_read, lecturas con caché)
+ * acumula por inode los bytes pedidos en la ventana y el último proceso
+ * lector. Con esos totales FileResidencyTracker mantiene el top-K de
+ * archivos por volumen (space-saving, ver heavy_hitters.h), abre cada uno a
+ * través de /proc/<pid>/fd y lo muestrea con la syscall cachestat (Linux
+ * 6.5+): páginas en caché y expulsadas recientemente.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "heavy_hitters.h"
+
+#ifndef __NR_cachestat
+#define __NR_cachestat 451   // mismo número en todas las arquitecturas
+#endif
+
+#define FILE_TRACK_FACTOR 4          // contadores space-saving por archivo reportado
+#define FILE_DECAY 0.8
+
+// Mismos campos que struct cachestat_range / struct cachestat de <linux/mman.h>
+struct CacheStatRange {
+    uint64_t off;
+    uint64_t len;      // 0 = hasta el final del archivo
+};
+
+struct CacheStat {
+    uint64_t nr_cache;
+    uint64_t nr_dirty;
+    uint64_t nr_writeback;
+    uint64_t nr_evicted;
+    uint64_t nr_recently_evicted;
+};
+
+// Mismo layout que file_key_t / file_val_t en el programa BPF
+struct FileKey {
+    uint64_t ino;
+    uint32_t dev;      // s_dev del superbloque (MKDEV del kernel)
+    uint32_t pad;
+
+    bool operator==(const FileKey& o) const { return ino == o.ino && dev == o.dev; }
+};
+
+struct FileReadValue {
+    uint64_t bytes;
+    uint64_t reads;
+    uint32_t tgid;     // último proceso que leyó
+    uint32_t pad;
+};
+
+struct FileKeyHash {
+    size_t operator()(const FileKey& k) const {
+        return std::hash<uint64_t>()(k.ino * 0x9E3779B97F4A7C15ULL ^ k.dev);
+    }
+};
+
+static inline int cachestat_fd(int fd, CacheStat* cs) {
+    CacheStatRange range = {0, 0};
+    return (int)syscall(__NR_cachestat, fd, &range, cs, 0);
+}
+
+struct ResidencySummary {
+    bool valid;                 // algún archivo muestreado
+    int files;                  // archivos del top-K muestreados
+    double cached_fraction;     // fracción en caché, ponderada por bytes leídos en la ventana
+    uint64_t recently_evicted;  // páginas expulsadas recientemente (suma del top-K)
+};
+
+class FileResidencyTracker {
+private:
+    struct OpenFile {
+        int fd;
+        uint64_t pages;
+    };
+
+    size_t top_k;
+    bool supported;
+    SpaceSaving<FileKey, FileKeyHash> tracker;
+    std::unordered_map<FileKey, OpenFile, FileKeyHash> open_files;
+
+    // Busca entre los descriptores del proceso uno que apunte al inode
+    static int open_via_proc(const FileKey& key, uint32_t tgid, uint64_t* pages) {
+        std::string dir = "/proc/" + std::to_string(tgid) + "/fd";
+        DIR* d = opendir(dir.c_str());
+        if (!d) return -1;
+        int fd = -1;
+        struct dirent* de;
+        while ((de = readdir(d)) != nullptr) {
+            if (de->d_name[0] == '.') continue;
+            std::string path = dir + "/" + de->d_name;
+            struct stat st;
+            if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            if (st.st_ino != key.ino || major(st.st_dev) != (key.dev >> 20) ||
+                minor(st.st_dev) != (key.dev & 0xFFFFF))
+                continue;
+            fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) *pages = ((uint64_t)st.st_size + 4095) / 4096;
+            break;
+        }
+        closedir(d);
+        return fd;
+    }
+
+public:
+    explicit FileResidencyTracker(size_t k)
+        : top_k(k), supported(true), tracker(k * FILE_TRACK_FACTOR) {}
+
+    ~FileResidencyTracker() {
+        for (auto& kv : open_files) close(kv.second.fd);
+    }
+
+    // false si el kernel no tiene cachestat (ENOSYS)
+    bool probe_support() {
+        int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return true;
+        CacheStat cs;
+        supported = !(cachestat_fd(fd, &cs) < 0 && errno == ENOSYS);
+        close(fd);
+        return supported;
+    }
+
+    /**
+     * Actualiza el top-K con las lecturas de la ventana y muestrea la
+     * residencia de esos archivos. Los que salen del top-K se cierran.
+     */
+    ResidencySummary update(const std::vector<std::pair<FileKey, FileReadValue>>& window) {
+        ResidencySummary sum = {false, 0, 0.0, 0};
+        std::unordered_map<FileKey, FileReadValue, FileKeyHash> reads;
+        for (const auto& kv : window) {
+            reads[kv.first] = kv.second;
+            tracker.add(kv.first, (double)kv.second.bytes);
+        }
+
+        std::unordered_map<FileKey, OpenFile, FileKeyHash> keep;
+        double weight = 0.0, cached = 0.0;
+        for (const auto& c : tracker.top(top_k)) {
+            auto of = open_files.find(c.key);
+            OpenFile f = {-1, 0};
+            if (of != open_files.end()) {
+                f = of->second;
+                open_files.erase(of);
+            } else {
+                auto r = reads.find(c.key);
+                if (r == reads.end()) continue;   // sin lector conocido todavía
+                f.fd = open_via_proc(c.key, r->second.tgid, &f.pages);
+                if (f.fd < 0) continue;
+            }
+            keep[c.key] = f;
+
+            CacheStat cs;
+            if (!supported || f.pages == 0 || cachestat_fd(f.fd, &cs) != 0) continue;
+            auto r = reads.find(c.key);
+            double w = (r == reads.end()) ? 0.0 : (double)r->second.bytes;
+            double frac = std::min(1.0, (double)cs.nr_cache / f.pages);
+            cached += w * frac;
+            weight += w;
+            sum.recently_evicted += cs.nr_recently_evicted;
+            sum.files++;
+        }
+
+        for (auto& kv : open_files) close(kv.second.fd);
+        open_files.swap(keep);
+        tracker.decay(FILE_DECAY);
+
+        sum.valid = sum.files > 0 && weight > 0.0;
+        sum.cached_fraction = weight > 0.0 ? cached / weight : 0.0;
+        return sum;
+    }
+};
@@ -0,0 +1,92 @@
+/*
+ * heavy_hitters.h
+ *
+ * Resumen "space-saving" (Metwally et al.) con pesos: sigue los K emisores
+ * con más bytes usando memoria fija, por muchos procesos o cgroups que
+ * aparezcan. Cada contador guarda su cota de error: un emisor nuevo que
+ * desplaza al mínimo hereda su cuenta como error, de modo que
+ * count - error <= real <= count.
+ *
+ * El colector lo alimenta una vez por ventana con los totales por emisor
+ * leídos del mapa LRU de BPF, y aplica decay() para que el top-K siga la
+ * actividad reciente.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+template <typename Key, typename Hash = std::hash<Key>>
+class SpaceSaving {
+public:
+    struct Counter {
+        Key key;
+        double count;   // cota superior del peso acumulado
+        double error;   // sobreestimación máxima
+    };
+
+private:
+    size_t capacity;
+    std::vector<Counter> counters;
+    std::unordered_map<Key, size_t, Hash> index;
+
+    // Con K pequeño (decenas) una búsqueda lineal del mínimo es más barata
+    // que mantener un heap; solo se hace al desplazar un contador.
+    size_t min_slot() const {
+        size_t m = 0;
+        for (size_t i = 1; i < counters.size(); i++)
+            if (counters[i].count < counters[m].count) m = i;
+        return m;
+    }
+
+public:
+    explicit SpaceSaving(size_t k) : capacity(k ? k : 1) {
+        counters.reserve(capacity);
+        index.reserve(capacity * 2);
+    }
+
+    void add(const Key& key, double weight) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            counters[it->second].count += weight;
+            return;
+        }
+        if (counters.size() < capacity) {
+            index[key] = counters.size();
+            counters.push_back({key, weight, 0.0});
+            return;
+        }
+        size_t m = min_slot();
+        Counter& c = counters[m];
+        index.erase(c.key);
+        c.error = c.count;
+        c.count += weight;
+        c.key = key;
+        index[key] = m;
+    }
+
+    // Envejece todos los contadores (factor en (0, 1])
+    void decay(double factor) {
+        for (Counter& c : counters) {
+            c.count *= factor;
+            c.error *= factor;
+        }
+    }
+
+    bool contains(const Key& key) const { return index.count(key) > 0; }
+
+    // Los k contadores mayores, de mayor a menor
+    std::vector<Counter> top(size_t k) const {
+        std::vector<Counter> out(counters);
+        std::sort(out.begin(), out.end(),
+                  [](const Counter& a, const Counter& b) { return a.count > b.count; });
+        if (out.size() > k) out.resize(k);
+        return out;
+    }
+
+    size_t size() const { return counters.size(); }
+};
@@ -0,0 +1,72 @@
+/*
+ * hyperloglog.h
+ *
+ * HyperLogLog para estimar en memoria fija cuántos sectores distintos y
+ * cuántos extents de 1 MB distintos toca cada ventana (el equivalente en
+ * vivo de trace_unique_sectors = len(set(sectors)) de consolidateV2.py).
+ *
+ * El programa BPF del colector mantiene los registros en un array per-CPU
+ * con el mismo hash y la misma regla de actualización que hll_add(); aquí
+ * se fusionan las CPUs (máximo por registro) y se calcula la estimación.
+ * Error relativo típico: 1.04 / sqrt(HLL_REGISTERS) ~ 3.3 %.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define HLL_PRECISION 10
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define HLL_EXTENT_SHIFT 11     // 2048 sectores de 512 B = 1 MB
+
+// Mismo layout que struct hll_regs_t en el programa BPF
+struct HllRegisters {
+    uint8_t regs[HLL_REGISTERS];
+};
+
+// Finalizador de splitmix64 (el programa BPF usa el mismo)
+static inline uint64_t hll_hash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline void hll_add(HllRegisters& h, uint64_t value) {
+    uint64_t x = hll_hash(value);
+    uint32_t idx = (uint32_t)(x >> (64 - HLL_PRECISION));
+    // Bit centinela: el rango máximo es 64 - HLL_PRECISION + 1
+    uint64_t w = (x << HLL_PRECISION) | (1ULL << (HLL_PRECISION - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(w) + 1);
+    if (rank > h.regs[idx]) h.regs[idx] = rank;
+}
+
+// Fusiona los registros de todas las CPUs (máximo por registro)
+static inline HllRegisters hll_merge(const std::vector<HllRegisters>& per_cpu) {
+    HllRegisters out;
+    memset(&out, 0, sizeof(out));
+    for (const HllRegisters& h : per_cpu)
+        for (int i = 0; i < HLL_REGISTERS; i++)
+            if (h.regs[i] > out.regs[i]) out.regs[i] = h.regs[i];
+    return out;
+}
+
+// Estimación de cardinalidad con la corrección de rango pequeño (linear counting)
+static inline double hll_estimate(const HllRegisters& h) {
+    const double m = HLL_REGISTERS;
+    double sum = 0.0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += std::ldexp(1.0, -(int)h.regs[i]);
+        if (h.regs[i] == 0) zeros++;
+    }
+    double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / zeros);
+    return e;
+}
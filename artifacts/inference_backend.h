@@ -0,0 +1,78 @@
+/*
+ * inference_backend.h
+ *
+ * Interfaz común de los backends de inferencia del daemon ml_predictor.
+ *
+ * Cada backend recibe características YA normalizadas (la normalización con
+ * el scaler es responsabilidad de MLPredictor) y devuelve la clase predicha.
+ * Las implementaciones se registran por nombre con REGISTER_INFERENCE_BACKEND
+ * y el bundle elige cuál usar con la clave "backend". Solo quedan
+ * disponibles los backends cuyos headers se incluyen en el binario.
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "model_bundle.h"
+#include "window_features.h"
+
+class InferenceBackend {
+public:
+    virtual ~InferenceBackend() {}
+
+    // Carga el modelo referenciado por el bundle; false + err si falla
+    virtual bool load(const ModelBundle& bundle, std::string* err) = 0;
+
+    // Ejecuta predicciones de prueba para calentar cachés y asignaciones
+    virtual void warm_up(int iterations = 100) {
+        float zeros[NUM_FEATURES] = {};
+        for (int i = 0; i < iterations; i++) predict(zeros);
+    }
+
+    // Clase predicha para un vector normalizado de num_features floats
+    virtual int predict(const float* normalized) = 0;
+
+    // n vectores consecutivos (n * num_features floats) -> n clases
+    virtual void predict_batch(const float* normalized, int n, int num_features, int* out) {
+        for (int i = 0; i < n; i++) out[i] = predict(normalized + (size_t)i * num_features);
+    }
+
+    // Descripción corta para logs e informes
+    virtual std::string describe() const = 0;
+};
+
+class BackendRegistry {
+public:
+    typedef std::function<std::unique_ptr<InferenceBackend>()> Factory;
+
+    static std::map<std::string, Factory>& factories() {
+        static std::map<std::string, Factory> f;
+        return f;
+    }
+
+    static bool add(const std::string& name, Factory factory) {
+        factories()[name] = factory;
+        return true;
+    }
+
+    static std::unique_ptr<InferenceBackend> create(const std::string& name) {
+        auto it = factories().find(name);
+        if (it == factories().end()) return nullptr;
+        return it->second();
+    }
+
+    static std::vector<std::string> names() {
+        std::vector<std::string> out;
+        for (const auto& kv : factories()) out.push_back(kv.first);
+        return out;
+    }
+};
+
+#define REGISTER_INFERENCE_BACKEND(name, cls)                                    \
+    static const bool registered_backend_##cls = BackendRegistry::add(          \
+        name, []() { return std::unique_ptr<InferenceBackend>(new cls()); })
@@ -0,0 +1,185 @@
+/*
+ * io_ring.h
+ *
+ * Anillo io_uring mínimo sobre las syscalls (sin liburing) para el
+ * generador de carga io_workload: lecturas y escrituras con offset sobre
+ * un descriptor, hasta `entries` en vuelo.
+ *
+ * Las colas SQ y CQ se comparten con el kernel por mmap; las cabezas y
+ * colas se leen con acquire y se publican con release, como en liburing.
+ * Requiere IORING_OP_READ/WRITE (Linux 5.6+).
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425    // mismo número en todas las arquitecturas
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+struct IoCompletion {
+    uint64_t user_data;
+    int32_t res;               // bytes transferidos o -errno
+};
+
+class IoRing {
+private:
+    int ring_fd;
+    unsigned sq_entries;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe* sqes;
+    size_t sqes_len;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned pending;          // SQEs preparados sin enviar
+
+    static unsigned load_acquire(const unsigned* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    static void store_release(unsigned* p, unsigned v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+    void release() {
+        if (sqes) munmap(sqes, sqes_len);
+        if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_len);
+        if (sq_ptr) munmap(sq_ptr, sq_len);
+        if (ring_fd >= 0) close(ring_fd);
+        ring_fd = -1;
+        sq_ptr = cq_ptr = nullptr;
+        sqes = nullptr;
+    }
+
+public:
+    IoRing() : ring_fd(-1), sq_entries(0), sq_ptr(nullptr), sq_len(0), cq_ptr(nullptr),
+               cq_len(0), sqes(nullptr), sqes_len(0), pending(0) {}
+
+    ~IoRing() { release(); }
+
+    /**
+     * Crea el anillo con al menos `entries` SQEs. Devuelve "" o la
+     * descripción del error.
+     */
+    std::string init(unsigned entries) {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        long fd = syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) return std::string("io_uring_setup: ") + strerror(errno);
+        ring_fd = (int)fd;
+        sq_entries = p.sq_entries;
+
+        sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single && cq_len > sq_len) sq_len = cq_len;
+
+        sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ptr == MAP_FAILED) {
+            sq_ptr = nullptr;
+            release();
+            return std::string("mmap SQ ring: ") + strerror(errno);
+        }
+        if (single) {
+            cq_ptr = sq_ptr;
+        } else {
+            cq_ptr = mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED) {
+                cq_ptr = nullptr;
+                release();
+                return std::string("mmap CQ ring: ") + strerror(errno);
+            }
+        }
+        sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+        void* s = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_SQES);
+        if (s == MAP_FAILED) {
+            release();
+            return std::string("mmap SQEs: ") + strerror(errno);
+        }
+        sqes = (struct io_uring_sqe*)s;
+
+        char* sq = (char*)sq_ptr;
+        sq_head = (unsigned*)(sq + p.sq_off.head);
+        sq_tail = (unsigned*)(sq + p.sq_off.tail);
+        sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+        sq_array = (unsigned*)(sq + p.sq_off.array);
+        char* cq = (char*)cq_ptr;
+        cq_head = (unsigned*)(cq + p.cq_off.head);
+        cq_tail = (unsigned*)(cq + p.cq_off.tail);
+        cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+        return "";
+    }
+
+    unsigned capacity() const { return sq_entries; }
+
+    // Prepara una lectura o escritura; false si la SQ está llena
+    bool prep_rw(bool write, int fd, void* buf, unsigned len, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        if (tail - load_acquire(sq_head) >= sq_entries) return false;
+        unsigned idx = tail & *sq_mask;
+        struct io_uring_sqe* sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        sq_array[idx] = idx;
+        store_release(sq_tail, tail + 1);
+        pending++;
+        return true;
+    }
+
+    /**
+     * Envía lo preparado y espera al menos min_complete finalizaciones.
+     * Devuelve 0 o -errno.
+     */
+    int submit(unsigned min_complete) {
+        unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        while (true) {
+            long rc = syscall(__NR_io_uring_enter, ring_fd, pending, min_complete, flags, nullptr, 0);
+            if (rc >= 0) {
+                pending -= (unsigned)rc < pending ? (unsigned)rc : pending;
+                return 0;
+            }
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Recoge las finalizaciones disponibles (hasta max); devuelve cuántas
+    unsigned reap(IoCompletion* out, unsigned max) {
+        unsigned head = *cq_head;
+        unsigned tail = load_acquire(cq_tail);
+        unsigned n = 0;
+        while (head != tail && n < max) {
+            const struct io_uring_cqe* cqe = &cqes[head & *cq_mask];
+            out[n].user_data = cqe->user_data;
+            out[n].res = cqe->res;
+            n++;
+            head++;
+        }
+        store_release(cq_head, head);
+        return n;
+    }
+};
@@ -0,0 +1,632 @@
+/*
+ * io_workload.cpp
+ *
+ * Generador de carga con io_uring para experimentos reproducibles, en lugar
+ * de invocaciones de fio con parámetros fijos.
+ *
+ * Ejecuta una secuencia de fases sobre un archivo o un dispositivo de
+ * bloque (p.ej. un loop), con caché de páginas u O_DIRECT. Cada fase tiene
+ * un patrón, una duración y sus parámetros:
+ *
+ *   seq      lectura secuencial; streams=N reparte N cursores secuenciales
+ *            intercalados en N regiones del archivo
+ *   rand     offsets uniformes alineados a bs
+ *   stride   saltos fijos de `stride` bytes entre el inicio de cada I/O
+ *   mix      seq_pct % de I/O secuencial y el resto aleatorio
+ *
+ *   --phase seq:20:bs=128k,qd=4 --phase rand:20:bs=4k,qd=16 \
+ *   --phase mix:20:seq_pct=50,read=70 --phase seq:20:streams=4
+ *
+ * La línea de tiempo (CSV) tiene una fila por intervalo con marcas de
+ * CLOCK_MONOTONIC, el reloj de bpf_ktime_get_ns: los intervalos se alinean
+ * directamente con los eventos de ebpf_block_trace --record. Cada fila
+ * lleva la etiqueta de la fase (sequential/random/mixed), que sirve de
+ * verdad de referencia por ventana. Con --label-socket la etiqueta de
+ * cada fase se envía además al colector en modo captura
+ * (ebpf_block_trace --capture --label-socket, ver dataset_capture.h).
+ *
+ * Compile:
+ *   make io_workload
+ *
+ * Uso:
+ *   ./io_workload --target ./testfile --size 1G --phase seq:10 --phase rand:10 \
+ *                 --timeline timeline.csv
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/fs.h>
+#include <sstream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include <getopt.h>
+
+#include "collector_config.h"
+#include "io_ring.h"
+
+// ============================================================================
+// CONFIG
+// ============================================================================
+
+#define DEFAULT_BS (128 * 1024)
+#define DEFAULT_QD 1
+#define DEFAULT_INTERVAL_MS 250
+#define DEFAULT_SEED 42
+#define MAX_QD 256
+#define IO_ALIGN 4096                   // alineación de buffers y offsets con O_DIRECT
+#define PREFILL_CHUNK (1024 * 1024)
+#define WORKLOAD_JUMP_BYTES 1000000     // sin configuración: el del colector (JUMP_THRESHOLD_BYTES)
+
+enum Pattern { PAT_SEQ = 0, PAT_RAND, PAT_STRIDE, PAT_MIX };
+
+static const char* const PATTERN_NAMES[4] = {"seq", "rand", "stride", "mix"};
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// "128k", "4M", "1G" -> bytes; 0 si no es válido
+static uint64_t parse_size(const std::string& s) {
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    if (end == s.c_str() || v < 0) return 0;
+    switch (*end) {
+        case 'k': case 'K': v *= 1024.0; break;
+        case 'm': case 'M': v *= 1024.0 * 1024.0; break;
+        case 'g': case 'G': v *= 1024.0 * 1024.0 * 1024.0; break;
+        case '\0': break;
+        default: return 0;
+    }
+    return (uint64_t)v;
+}
+
+// ============================================================================
+// FASES
+// ============================================================================
+
+struct PhaseSpec {
+    int pattern;
+    double seconds;
+    uint64_t bs;
+    int qd;
+    uint64_t stride;     // stride: distancia entre inicios de I/O
+    int read_pct;        // % de lecturas (el resto escrituras)
+    int seq_pct;         // mix: % de I/O secuencial
+    int streams;         // seq: cursores intercalados
+    std::string label;   // clase de referencia (sequential/random/mixed)
+
+    /**
+     * Clase que verá el colector a nivel de bloque si no se indica label=:
+     * varios flujos secuenciales intercalados o un stride por encima del
+     * umbral de salto ya no son secuenciales para él. El colector mide la
+     * distancia entre inicios de petición, que en stride es el propio stride.
+     *
+     * @param jump_threshold_bytes Umbral de salto del colector para el dispositivo
+     */
+    std::string default_label(uint64_t jump_threshold_bytes) const {
+        switch (pattern) {
+            case PAT_SEQ: return streams > 1 ? "mixed" : "sequential";
+            case PAT_RAND: return "random";
+            case PAT_STRIDE: return stride > jump_threshold_bytes ? "random" : "sequential";
+            default: return "mixed";
+        }
+    }
+};
+
+/**
+ * "patrón:segundos[:clave=valor,...]". Claves: bs, qd, stride, read,
+ * seq_pct, streams, label. Sin label= la etiqueta se decide en main(), con
+ * el umbral de salto del dispositivo. Devuelve "" o la descripción del error.
+ */
+static std::string parse_phase(const std::string& spec, PhaseSpec* p) {
+    *p = PhaseSpec{PAT_SEQ, 0.0, DEFAULT_BS, DEFAULT_QD, 0, 100, 50, 1, ""};
+    std::vector<std::string> parts;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ':')) parts.push_back(item);
+    if (parts.size() < 2 || parts.size() > 3) return "expected pattern:seconds[:options]";
+
+    p->pattern = -1;
+    for (int i = 0; i < 4; i++)
+        if (parts[0] == PATTERN_NAMES[i]) p->pattern = i;
+    if (p->pattern < 0) return "unknown pattern " + parts[0];
+    p->seconds = atof(parts[1].c_str());
+    if (p->seconds <= 0) return "invalid duration " + parts[1];
+
+    if (parts.size() == 3) {
+        std::stringstream os(parts[2]);
+        while (std::getline(os, item, ',')) {
+            size_t eq = item.find('=');
+            if (eq == std::string::npos) return "expected key=value in " + item;
+            std::string k = item.substr(0, eq), v = item.substr(eq + 1);
+            if (k == "bs") p->bs = parse_size(v);
+            else if (k == "qd") p->qd = atoi(v.c_str());
+            else if (k == "stride") p->stride = parse_size(v);
+            else if (k == "read") p->read_pct = atoi(v.c_str());
+            else if (k == "seq_pct") p->seq_pct = atoi(v.c_str());
+            else if (k == "streams") p->streams = atoi(v.c_str());
+            else if (k == "label") p->label = v;
+            else return "unknown option " + k;
+        }
+    }
+    if (p->bs == 0 || p->bs % 512 != 0) return "bs must be a multiple of 512";
+    if (p->qd < 1 || p->qd > MAX_QD) return "qd must be in 1.." + std::to_string(MAX_QD);
+    if (p->read_pct < 0 || p->read_pct > 100 || p->seq_pct < 0 || p->seq_pct > 100)
+        return "percentages must be in 0..100";
+    if (p->streams < 1) return "streams must be >= 1";
+    if (p->pattern == PAT_STRIDE && p->stride < p->bs) p->stride = 2 * p->bs;
+    return "";
+}
+
+// ============================================================================
+// OFFSETS
+// ============================================================================
+
+// xorshift64*: reproducible con --seed
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed ? seed : 1) {}
+    uint64_t next() {
+        s ^= s >> 12;
+        s ^= s << 25;
+        s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+};
+
+class OffsetGenerator {
+private:
+    const PhaseSpec& p;
+    uint64_t size;           // bytes utilizables (múltiplo de bs)
+    uint64_t region;         // seq con streams: tamaño de cada región
+    std::vector<uint64_t> cursors;
+    size_t turn;
+    Rng& rng;
+
+    uint64_t random_offset() { return (rng.next() % (size / p.bs)) * p.bs; }
+
+    uint64_t sequential_offset() {
+        size_t i = turn++ % cursors.size();
+        uint64_t off = i * region + cursors[i];
+        cursors[i] += p.bs;
+        if (cursors[i] + p.bs > region) cursors[i] = 0;
+        return off;
+    }
+
+public:
+    OffsetGenerator(const PhaseSpec& phase, uint64_t target_size, Rng& r)
+        : p(phase), size(target_size / phase.bs * phase.bs), turn(0), rng(r) {
+        int streams = phase.pattern == PAT_SEQ ? phase.streams : 1;
+        region = size / streams / phase.bs * phase.bs;
+        if (region < phase.bs) region = phase.bs;
+        cursors.assign(streams, 0);
+    }
+
+    uint64_t next() {
+        switch (p.pattern) {
+            case PAT_RAND:
+                return random_offset();
+            case PAT_STRIDE: {
+                uint64_t off = cursors[0];
+                cursors[0] += p.stride;
+                if (cursors[0] + p.bs > size) {
+                    // Siguiente pasada desplazada bs dentro del stride
+                    uint64_t lane = (off % p.stride + p.bs) % p.stride;
+                    cursors[0] = lane + p.bs > size ? 0 : lane;
+                }
+                return off;
+            }
+            case PAT_MIX:
+                return (int)(rng.next() % 100) < p.seq_pct ? sequential_offset() : random_offset();
+            default:
+                return sequential_offset();
+        }
+    }
+
+    bool next_is_write() { return (int)(rng.next() % 100) >= p.read_pct; }
+};
+
+// ============================================================================
+// LÍNEA DE TIEMPO
+// ============================================================================
+
+struct IntervalStats {
+    uint64_t start_ns;
+    uint64_t reads, writes, bytes, errors;
+    std::vector<double> lat_us;
+
+    void reset(uint64_t t) {
+        start_ns = t;
+        reads = writes = bytes = errors = 0;
+        lat_us.clear();
+    }
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    size_t k = (size_t)(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static void timeline_header(FILE* fp) {
+    fprintf(fp, "start_ns,end_ns,phase,pattern,label,reads,writes,bytes,mbps,iops,"
+                "lat_avg_us,lat_p99_us,errors\n");
+}
+
+static void timeline_row(FILE* fp, IntervalStats& st, uint64_t end_ns, int phase,
+                         const PhaseSpec& p) {
+    double secs = (end_ns - st.start_ns) / 1e9;
+    if (secs <= 0) return;
+    double sum = 0.0;
+    for (double l : st.lat_us) sum += l;
+    uint64_t ios = st.reads + st.writes;
+    fprintf(fp, "%llu,%llu,%d,%s,%s,%llu,%llu,%llu,%.2f,%.1f,%.1f,%.1f,%llu\n",
+            (unsigned long long)st.start_ns, (unsigned long long)end_ns, phase,
+            PATTERN_NAMES[p.pattern], p.label.c_str(), (unsigned long long)st.reads,
+            (unsigned long long)st.writes, (unsigned long long)st.bytes,
+            st.bytes / secs / (1024.0 * 1024.0), ios / secs,
+            st.lat_us.empty() ? 0.0 : sum / st.lat_us.size(), percentile(st.lat_us, 0.99),
+            (unsigned long long)st.errors);
+    fflush(fp);
+}
+
+// ============================================================================
+// ETIQUETAS PARA EL COLECTOR
+// ============================================================================
+
+// Envía un mensaje de control ("label <clase>", "run <id>") al colector; sin colector no pasa nada
+static void send_label_msg(const std::string& sock_path, const std::string& msg) {
+    if (sock_path.empty()) return;
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (sendto(fd, msg.data(), msg.size(), 0, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        static bool warned = false;
+        if (!warned) std::cerr << "WARNING: label socket " << sock_path << ": " << strerror(errno) << "\n";
+        warned = true;
+    }
+    close(fd);
+}
+
+// ============================================================================
+// EJECUCIÓN
+// ============================================================================
+
+class Workload {
+private:
+    int fd;
+    uint64_t size;
+    bool direct;
+    int interval_ms;
+    FILE* timeline;
+    std::string label_sock;
+    Rng rng;
+    IoRing ring;
+    std::vector<void*> buffers;
+    std::vector<uint64_t> submitted_ns;
+    std::vector<bool> slot_write;
+
+public:
+    Workload(int f, uint64_t sz, bool d, int interval, FILE* tl, const std::string& lsock,
+             uint64_t seed)
+        : fd(f), size(sz), direct(d), interval_ms(interval), timeline(tl), label_sock(lsock),
+          rng(seed) {}
+
+    ~Workload() {
+        for (void* b : buffers) free(b);
+    }
+
+    bool init(uint64_t max_bs) {
+        std::string err = ring.init(MAX_QD);
+        if (!err.empty()) {
+            std::cerr << "ERROR: " << err << "\n";
+            return false;
+        }
+        for (int i = 0; i < MAX_QD; i++) {
+            void* b = nullptr;
+            if (posix_memalign(&b, IO_ALIGN, max_bs) != 0) return false;
+            memset(b, 0xA5, max_bs);
+            buffers.push_back(b);
+        }
+        submitted_ns.assign(MAX_QD, 0);
+        slot_write.assign(MAX_QD, false);
+        return true;
+    }
+
+    int run_phase(int index, const PhaseSpec& p) {
+        // Como fio --invalidate=1: cada fase empieza con la caché fría
+        if (!direct) posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+        OffsetGenerator gen(p, size, rng);
+        send_label_msg(label_sock, "label " + p.label);
+        uint64_t start = monotonic_ns();
+        uint64_t end = start + (uint64_t)(p.seconds * 1e9);
+        uint64_t interval_ns = (uint64_t)interval_ms * 1000000ULL;
+        uint64_t next_row = start + interval_ns;
+        IntervalStats st;
+        st.reset(start);
+        uint64_t total_ios = 0, total_bytes = 0, total_errors = 0;
+
+        std::vector<int> free_slots;
+        for (int i = p.qd - 1; i >= 0; i--) free_slots.push_back(i);
+        int inflight = 0;
+        IoCompletion done[MAX_QD];
+
+        while (true) {
+            uint64_t now = monotonic_ns();
+            bool issuing = now < end;
+            while (issuing && !free_slots.empty()) {
+                int slot = free_slots.back();
+                bool write = gen.next_is_write();
+                uint64_t off = gen.next();
+                if (!ring.prep_rw(write, fd, buffers[slot], (unsigned)p.bs, off, (uint64_t)slot))
+                    break;
+                free_slots.pop_back();
+                slot_write[slot] = write;
+                submitted_ns[slot] = monotonic_ns();
+                inflight++;
+            }
+            if (inflight == 0) break;
+
+            int rc = ring.submit(1);
+            if (rc < 0) {
+                std::cerr << "ERROR: io_uring_enter: " << strerror(-rc) << "\n";
+                return 1;
+            }
+            unsigned n = ring.reap(done, MAX_QD);
+            uint64_t t = monotonic_ns();
+            for (unsigned i = 0; i < n; i++) {
+                int slot = (int)done[i].user_data;
+                inflight--;
+                free_slots.push_back(slot);
+                if (done[i].res < 0) {
+                    st.errors++;
+                    total_errors++;
+                    if (total_errors == 1)
+                        std::cerr << "WARNING: I/O error: " << strerror(-done[i].res) << "\n";
+                    continue;
+                }
+                (slot_write[slot] ? st.writes : st.reads)++;
+                st.bytes += (uint64_t)done[i].res;
+                st.lat_us.push_back((t - submitted_ns[slot]) / 1e3);
+                total_ios++;
+                total_bytes += (uint64_t)done[i].res;
+            }
+
+            while (timeline && t >= next_row) {
+                timeline_row(timeline, st, next_row, index, p);
+                st.reset(next_row);
+                next_row += interval_ns;
+            }
+        }
+        uint64_t stop = monotonic_ns();
+        send_label_msg(label_sock, "label");
+        if (timeline && st.reads + st.writes + st.errors > 0) timeline_row(timeline, st, stop, index, p);
+
+        double secs = (stop - start) / 1e9;
+        fprintf(stderr, "Phase %d %s (%s) bs=%llu qd=%d: %.1f s, %.1f MB/s, %.0f IOPS, %llu errors"
+                        " [%llu, %llu]\n",
+                index, PATTERN_NAMES[p.pattern], p.label.c_str(), (unsigned long long)p.bs, p.qd,
+                secs, total_bytes / secs / (1024.0 * 1024.0), total_ios / secs,
+                (unsigned long long)total_errors, (unsigned long long)start,
+                (unsigned long long)stop);
+        return 0;
+    }
+};
+
+// Tamaño del objetivo: dispositivo de bloque o archivo (creado/rellenado si hace falta)
+static bool prepare_target(const std::string& path, uint64_t want, bool direct,
+                           int* fd_out, uint64_t* size_out) {
+    int flags = O_RDWR | O_CREAT | (direct ? O_DIRECT : 0);
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open " << path << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    uint64_t size = 0;
+    if (S_ISBLK(st.st_mode)) {
+        if (ioctl(fd, BLKGETSIZE64, &size) != 0) size = 0;
+        if (want && want < size) size = want;
+    } else {
+        size = (uint64_t)st.st_size;
+        if (want > size) {
+            // Los huecos de un archivo disperso no llegan al disco: se escriben datos reales
+            std::cerr << "Filling " << path << " up to " << want << " bytes...\n";
+            int wfd = open(path.c_str(), O_WRONLY);
+            std::vector<char> chunk(PREFILL_CHUNK, (char)0x5A);
+            for (uint64_t off = size; off < want; off += PREFILL_CHUNK) {
+                size_t len = (size_t)std::min<uint64_t>(PREFILL_CHUNK, want - off);
+                if (pwrite(wfd, chunk.data(), len, (off_t)off) != (ssize_t)len) {
+                    std::cerr << "ERROR: Cannot fill " << path << ": " << strerror(errno) << "\n";
+                    close(wfd);
+                    close(fd);
+                    return false;
+                }
+            }
+            fsync(wfd);
+            close(wfd);
+            size = want;
+        } else if (want) {
+            size = want;
+        }
+    }
+    if (size < IO_ALIGN) {
+        std::cerr << "ERROR: " << path << " is empty; use --size\n";
+        close(fd);
+        return false;
+    }
+    *fd_out = fd;
+    *size_out = size;
+    return true;
+}
+
+/**
+ * Nombre en /sys/class/block del dispositivo que atiende la I/O del
+ * objetivo: el propio dispositivo o el que contiene el archivo. "" si no
+ * se puede resolver (p.ej. tmpfs).
+ */
+static std::string target_block_name(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return "";
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+    std::string link = "/sys/dev/block/" + std::to_string(major(dev)) + ":" +
+                       std::to_string(minor(dev));
+    char buf[PATH_MAX];
+    if (!realpath(link.c_str(), buf)) return "";
+    std::string p(buf);
+    return p.substr(p.rfind('/') + 1);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::string target;
+    uint64_t size = 0;
+    bool direct = false;
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    std::string timeline_path;
+    uint64_t seed = DEFAULT_SEED;
+    std::string label_sock;
+    std::string run_id;
+    std::string config_path = DEFAULT_CONFIG_PATH;
+    std::string dev_class;
+    std::vector<PhaseSpec> phases;
+
+    static struct option long_opts[] = {
+        {"target", required_argument, 0, 'f'},
+        {"size", required_argument, 0, 's'},
+        {"direct", no_argument, 0, 'd'},
+        {"phase", required_argument, 0, 'p'},
+        {"interval-ms", required_argument, 0, 'i'},
+        {"timeline", required_argument, 0, 't'},
+        {"seed", required_argument, 0, 'S'},
+        {"label-socket", required_argument, 0, 'L'},
+        {"run-id", required_argument, 0, 'I'},
+        {"config", required_argument, 0, 'c'},
+        {"device-class", required_argument, 0, 'D'},
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "f:s:dp:i:t:h", long_opts, nullptr)) != -1) {
+        if (opt == 'f') target = optarg;
+        else if (opt == 's') size = parse_size(optarg);
+        else if (opt == 'd') direct = true;
+        else if (opt == 'p') {
+            PhaseSpec p;
+            std::string err = parse_phase(optarg, &p);
+            if (!err.empty()) {
+                std::cerr << "ERROR: --phase " << optarg << ": " << err << "\n";
+                return 1;
+            }
+            phases.push_back(p);
+        }
+        else if (opt == 'i') interval_ms = std::max(1, atoi(optarg));
+        else if (opt == 't') timeline_path = optarg;
+        else if (opt == 'S') seed = strtoull(optarg, nullptr, 10);
+        else if (opt == 'L') label_sock = optarg;
+        else if (opt == 'I') run_id = optarg;
+        else if (opt == 'c') config_path = optarg;
+        else if (opt == 'D') dev_class = optarg;
+        else if (opt == 'h') {
+            std::cout << "Usage: " << argv[0] << " --target <file|dev> --phase <spec> [...]\n"
+                      << "  -f, --target <path>       File or block device (e.g. /dev/loop0)\n"
+                      << "  -s, --size <bytes>        File size, created/filled if needed (e.g. 1G);\n"
+                      << "                            for devices, limits the range used\n"
+                      << "  -d, --direct              O_DIRECT (bypass the page cache)\n"
+                      << "  -p, --phase <spec>        pattern:seconds[:key=value,...], repeatable\n"
+                      << "                            patterns: seq, rand, stride, mix\n"
+                      << "                            keys: bs, qd, stride, read (% reads),\n"
+                      << "                            seq_pct (mix), streams (seq), label\n"
+                      << "  -i, --interval-ms <ms>    Timeline interval (default: 250)\n"
+                      << "  -t, --timeline <csv>      Per-interval timeline ('-' = stdout)\n"
+                      << "      --seed <n>            Random seed (default: 42)\n"
+                      << "      --label-socket <path>  Send each phase label to ebpf_block_trace --capture\n"
+                      << "      --run-id <id>         run_id sent to the collector before the first phase\n"
+                      << "      --config <path>       Collector config for the jump threshold behind\n"
+                      << "                            default labels (default: " DEFAULT_CONFIG_PATH ")\n"
+                      << "      --device-class <c>    Config section (default: detected from the target)\n"
+                      << "  -h, --help                Show this help\n";
+            return 0;
+        }
+    }
+
+    if (target.empty() || phases.empty()) {
+        std::cerr << "ERROR: --target and at least one --phase are required\n";
+        return 1;
+    }
+
+    uint64_t max_bs = 0;
+    for (const PhaseSpec& p : phases) max_bs = std::max(max_bs, p.bs);
+    if (direct && max_bs % IO_ALIGN != 0) {
+        std::cerr << "ERROR: with --direct bs must be a multiple of " << IO_ALIGN << "\n";
+        return 1;
+    }
+
+    int fd;
+    if (!prepare_target(target, size, direct, &fd, &size)) return 1;
+
+    // Etiquetas por defecto con el mismo umbral de salto que usará el colector
+    CollectorConfig config;
+    bool have_config = config.load(config_path);
+    if (dev_class.empty()) {
+        std::string blk = target_block_name(fd);
+        dev_class = blk.empty() ? "default" : detect_device_class(blk);
+    }
+    uint64_t jump_threshold = (uint64_t)config.get_int(dev_class, "jump_threshold_bytes",
+                                                       WORKLOAD_JUMP_BYTES);
+    if (have_config)
+        std::cerr << "Loaded " << config_path << " (device class " << dev_class
+                  << ", jump threshold " << jump_threshold << " bytes)\n";
+    for (PhaseSpec& p : phases)
+        if (p.label.empty()) p.label = p.default_label(jump_threshold);
+
+    FILE* timeline = nullptr;
+    if (!timeline_path.empty()) {
+        timeline = timeline_path == "-" ? stdout : fopen(timeline_path.c_str(), "w");
+        if (!timeline) {
+            std::cerr << "ERROR: Cannot open " << timeline_path << ": " << strerror(errno) << "\n";
+            close(fd);
+            return 1;
+        }
+        timeline_header(timeline);
+    }
+
+    int rc = 0;
+    {
+        Workload w(fd, size, direct, interval_ms, timeline, label_sock, seed);
+        if (!run_id.empty()) send_label_msg(label_sock, "run " + run_id);
+        if (!w.init(max_bs)) rc = 1;
+        for (size_t i = 0; rc == 0 && i < phases.size(); i++)
+            rc = w.run_phase((int)i, phases[i]);
+    }
+
+    if (timeline && timeline != stdout) fclose(timeline);
+    close(fd);
+    return rc;
+}
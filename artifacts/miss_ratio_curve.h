@@ -0,0 +1,172 @@
+/*
+ * miss_ratio_curve.h
+ *
+ * Curva de fallos (miss ratio curve, MRC) online con muestreo espacial
+ * SHARDS de tamaño fijo (Waldspurger et al., FAST'15) sobre extents de
+ * bloque.
+ *
+ * - Solo se siguen los extents cuyo hash cae bajo el umbral T (tasa
+ *   R = T / SHARDS_MODULUS); la distancia de reuso medida entre muestras se
+ *   escala por 1/R.
+ * - Como mucho max_samples extents a la vez: al superarlo se expulsa el de
+ *   hash mayor, T baja a ese hash y el histograma se reescala a la nueva
+ *   tasa. Memoria y CPU quedan acotadas sea cual sea el working set.
+ * - La distancia de reuso (extents distintos tocados desde el último acceso)
+ *   se obtiene con un árbol de estadísticos de orden sobre el instante del
+ *   último acceso de cada muestra: O(log max_samples) por acceso muestreado.
+ *
+ * El histograma usa cubos log2 de la distancia (en extents) y decay() lo
+ * envejece para que la curva siga la carga reciente.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+#define MRC_EXTENT_SHIFT 7              // 128 sectores de 512 B = 64 KB
+#define MRC_MAX_SAMPLES 8192
+#define MRC_INITIAL_RATE 0.01
+#define MRC_BUCKETS 48                  // distancias hasta 2^48 extents
+#define SHARDS_MODULUS (1ULL << 24)
+
+class ShardsMRC {
+private:
+    typedef __gnu_pbds::tree<uint64_t, __gnu_pbds::null_type, std::less<uint64_t>,
+                             __gnu_pbds::rb_tree_tag,
+                             __gnu_pbds::tree_order_statistics_node_update> OrderTree;
+
+    struct Sample {
+        uint64_t last_access;
+        uint64_t hash;
+    };
+
+    int extent_shift;
+    size_t max_samples;
+    uint64_t threshold;
+    uint64_t clock;
+
+    std::unordered_map<uint64_t, Sample> samples;       // extent -> muestra
+    OrderTree recency;                                  // last_access de cada muestra
+    std::set<std::pair<uint64_t, uint64_t>> by_hash;    // (hash, extent) para expulsar
+
+    double hist[MRC_BUCKETS];   // reusos con distancia en [2^b, 2^(b+1)) extents
+    double cold;                // primeros accesos (fallo a cualquier tamaño)
+    double total;
+
+    static uint64_t hash_extent(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x & (SHARDS_MODULUS - 1);
+    }
+
+    void rescale(double factor) {
+        for (double& h : hist) h *= factor;
+        cold *= factor;
+        total *= factor;
+    }
+
+    void evict_largest() {
+        auto last = std::prev(by_hash.end());
+        uint64_t old_threshold = threshold;
+        threshold = last->first;
+        auto it = samples.find(last->second);
+        recency.erase(it->second.last_access);
+        samples.erase(it);
+        by_hash.erase(last);
+        if (old_threshold > 0) rescale((double)threshold / old_threshold);
+    }
+
+public:
+    ShardsMRC(int shift = MRC_EXTENT_SHIFT, size_t max_s = MRC_MAX_SAMPLES,
+              double initial_rate = MRC_INITIAL_RATE)
+        : extent_shift(shift), max_samples(max_s ? max_s : 1),
+          threshold((uint64_t)(initial_rate * SHARDS_MODULUS)), clock(0),
+          hist(), cold(0.0), total(0.0) {
+        if (threshold == 0) threshold = 1;
+    }
+
+    void access(uint64_t sector) {
+        uint64_t extent = sector >> extent_shift;
+        uint64_t h = hash_extent(extent);
+        if (h >= threshold) return;
+
+        uint64_t now = ++clock;
+        auto it = samples.find(extent);
+        if (it == samples.end()) {
+            cold += 1.0;
+            total += 1.0;
+            samples[extent] = {now, h};
+            recency.insert(now);
+            by_hash.insert({h, extent});
+            while (samples.size() > max_samples) evict_largest();
+            return;
+        }
+
+        // Muestras tocadas después del último acceso a este extent
+        uint64_t newer = recency.size() - recency.order_of_key(it->second.last_access) - 1;
+        double distance = (double)(newer + 1) / sampling_rate();
+        int b = std::min(MRC_BUCKETS - 1, (int)std::log2(distance));
+        hist[b] += 1.0;
+        total += 1.0;
+
+        recency.erase(it->second.last_access);
+        recency.insert(now);
+        it->second.last_access = now;
+    }
+
+    // Envejece el histograma (factor en (0, 1])
+    void decay(double factor) { rescale(factor); }
+
+    double sampling_rate() const { return (double)threshold / SHARDS_MODULUS; }
+
+    uint64_t extent_bytes() const { return 512ULL << extent_shift; }
+
+    // Fracción de accesos que fallarían en una caché LRU de cache_bytes
+    double miss_ratio(uint64_t cache_bytes) const {
+        if (total <= 0.0) return 0.0;
+        return cold / total + reuse_miss_ratio(cache_bytes);
+    }
+
+    /**
+     * Parte de miss_ratio() debida a reusos que no caben (sin los primeros
+     * accesos): si es alta, la caché ya está expulsando datos que se
+     * vuelven a pedir.
+     */
+    double reuse_miss_ratio(uint64_t cache_bytes) const {
+        if (total <= 0.0) return 0.0;
+        double c = (double)cache_bytes / extent_bytes();
+        double misses = 0.0;
+        for (int b = 0; b < MRC_BUCKETS; b++) {
+            double lo = std::ldexp(1.0, b), hi = std::ldexp(1.0, b + 1);
+            if (lo >= c) misses += hist[b];
+            else if (hi > c) misses += hist[b] * (hi - c) / (hi - lo);   // interpolación lineal
+        }
+        return misses / total;
+    }
+
+    /**
+     * Tamaño de caché a partir del cual los reusos dejan de fallar (salvo
+     * una fracción tolerance): estimación del working set reutilizado.
+     */
+    uint64_t working_set_bytes(double tolerance = 0.01) const {
+        for (int b = 0; b < MRC_BUCKETS; b++) {
+            uint64_t size = (uint64_t)std::ldexp((double)extent_bytes(), b);
+            if (reuse_miss_ratio(size) <= tolerance) return size;
+        }
+        return (uint64_t)std::ldexp((double)extent_bytes(), MRC_BUCKETS);
+    }
+
+    size_t tracked() const { return samples.size(); }
+};
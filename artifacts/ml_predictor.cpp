@@ -23,15 +23,31 @@
 #include <vector>
 #include <chrono>
 
+#include "model_bundle.h"
+#include "inference_backend.h"
+#include "backend_torchscript.h"
+#include "backend_trees.h"
+#include "drift_monitor.h"
+#include "feature_plan.h"
+#include "predictor_protocol.h"
+#include "usdt.h"
+
 // ============================================================================
 // CONFIGURACIÓN
 // ============================================================================
 
 #define SOCKET_PATH "/tmp/ml_predictor.sock"
 #define MODEL_PATH_DEFAULT "./model_ts.pt"
-#define MAX_CONNECTIONS 10
+#define BUNDLE_PATH_DEFAULT "./" BUNDLE_MANIFEST_NAME
+// Las ventanas de muchos colectores pueden cerrar a la vez: con un backlog
+// corto los connect() no bloqueantes fallan con EAGAIN antes de la inferencia
+#define LISTEN_BACKLOG SOMAXCONN
+// Espera máxima por la petición de un cliente: uno que conecta y no envía
+// no puede bloquear al resto (el colector espera 50 ms por defecto)
+#define CLIENT_IO_TIMEOUT_MS 100
 
-// Parámetros de normalización (scaler)
+// Parámetros de normalización (scaler) por defecto; el bundle los sustituye
+// con feature_means/feature_stds si build_dataset_from_consolidated.py los escribió.
 // IMPORTANTE: El orden de las características debe ser:
 // [0] Distancia promedio entre offsets (bytes)
 // [1] Variabilidad (jump ratio, 0.0-1.0)
@@ -145,62 +161,147 @@ public:
 
 class MLPredictor {
 private:
-    torch::jit::script::Module model;
+    // Backend elegido por el bundle (ver inference_backend.h)
+    std::unique_ptr<InferenceBackend> backend;
     uint64_t prediction_count;
+
+    // Scaler y referencia de drift del bundle
+    float means[5];
+    float stds[5];
+    DriftMonitor drift;
+    uint64_t ood_count;
+
+    // Flujo de I/O con el que se entrenó el modelo (PREDICT_STREAM_*)
+    uint32_t stream;
     
     // Normalizar features usando parámetros del scaler
     void normalize_features(const float* raw, float* normalized) {
         for (int i = 0; i < 5; i++) {
-            if (FEATURE_STDS[i] > 0.0001f) {
-                normalized[i] = (raw[i] - FEATURE_MEANS[i]) / FEATURE_STDS[i];
+            if (stds[i] > 0.0001f) {
+                normalized[i] = (raw[i] - means[i]) / stds[i];
             } else {
                 normalized[i] = 0.0f;
             }
         }
     }
+
+    void load_scaler(const ModelBundle& bundle) {
+        std::copy(FEATURE_MEANS, FEATURE_MEANS + 5, means);
+        std::copy(FEATURE_STDS, FEATURE_STDS + 5, stds);
+
+        std::vector<float> m = bundle.get_floats("feature_means");
+        std::vector<float> s = bundle.get_floats("feature_stds");
+        if (m.size() == 5 && s.size() == 5) {
+            std::copy(m.begin(), m.end(), means);
+            std::copy(s.begin(), s.end(), stds);
+            std::cout << "✓ Scaler cargado del bundle" << std::endl;
+        } else {
+            std::cout << "⚠️  Bundle sin feature_means/feature_stds, usando scaler por defecto"
+                      << std::endl;
+        }
+        for (int i = 0; i < 5; i++) {
+            if (stds[i] <= 0.0001f) {
+                std::cout << "⚠️  Característica " << i << " constante en entrenamiento: "
+                          << "se normaliza a 0" << std::endl;
+            }
+        }
+
+        // Características que el modelo no declara (clave "features"): el
+        // colector puede no calcularlas, se normalizan a 0 y no se vigilan
+        uint32_t used = FP_ALL_FEATURES;
+        std::string err;
+        if (!FeaturePlan::parse_features(bundle.get("features"), &used, &err)) {
+            std::cout << "⚠️  features del bundle no válido (" << err << "), se usan todas"
+                      << std::endl;
+            used = FP_ALL_FEATURES;
+        }
+        if (used != FP_ALL_FEATURES) {
+            std::cout << "✓ Características del modelo:";
+            for (int i = 0; i < 5; i++) {
+                if (used & (1u << i)) std::cout << " " << FEATURE_NAMES[i];
+                else stds[i] = 0.0f;
+            }
+            std::cout << std::endl;
+        }
+
+        if (drift.load(bundle, 5, stds)) {
+            std::cout << "✓ Referencia de drift cargada (vigiladas:";
+            for (int i = 0; i < 5; i++) if (drift.watched(i)) std::cout << " " << i;
+            std::cout << ")" << std::endl;
+        } else {
+            std::cout << "⚠️  Bundle sin referencia de drift, monitor desactivado" << std::endl;
+        }
+    }
+
+    void log_drift() {
+        for (const auto& kv : drift.snapshot()) {
+            const DriftResult& d = kv.second;
+            std::cout << "    drift dev=" << (kv.first >> 20) << ":" << (kv.first & 0xFFFFF)
+                      << " psi=" << d.psi_max << " ks=" << d.ks_max
+                      << " worst=" << d.worst_feature
+                      << " out_of_range=" << d.out_of_range
+                      << (d.ood ? " OOD" : (d.drift ? " DRIFT" : ""))
+                      << (d.warmed ? "" : " (calentando)") << std::endl;
+        }
+    }
     
 public:
-    MLPredictor(const std::string& model_path) : prediction_count(0) {
-        std::cout << "Cargando modelo desde: " << model_path << std::endl;
-        
-        try {
-            model = torch::jit::load(model_path);
-            model.eval();  // Modo evaluación (desactiva dropout, etc.)
-            
-            std::cout << "✓ Modelo cargado correctamente" << std::endl;
-        } catch (const c10::Error& e) {
-            std::cerr << "❌ Error cargando modelo: " << e.what() << std::endl;
-            throw;
+    MLPredictor(const std::string& bundle_path)
+        : prediction_count(0), ood_count(0), stream(PREDICT_STREAM_ALL) {
+        ModelBundle bundle;
+        if (!bundle.open(bundle_path)) {
+            std::cerr << "❌ Error leyendo bundle: " << bundle_path << std::endl;
+            throw std::runtime_error("cannot open model bundle");
+        }
+
+        std::string name = bundle.backend();
+        backend = BackendRegistry::create(name);
+        if (!backend) {
+            std::cerr << "❌ Backend desconocido: " << name << std::endl;
+            throw std::runtime_error("unknown inference backend " + name);
+        }
+
+        std::cout << "Cargando modelo desde: " << bundle_path << " (backend " << name << ")"
+                  << std::endl;
+        std::string err;
+        if (!backend->load(bundle, &err)) {
+            std::cerr << "❌ Error cargando modelo: " << err << std::endl;
+            throw std::runtime_error("cannot load model: " + err);
         }
+        backend->warm_up();
+        std::cout << "✓ Modelo cargado correctamente: " << backend->describe() << std::endl;
+
+        load_scaler(bundle);
+
+        std::string stream_name = bundle.get("stream", "all");
+        int s = parse_predict_stream(stream_name);
+        if (s < 0) {
+            std::cout << "⚠️  stream desconocido en el bundle (" << stream_name
+                      << "), se asume all" << std::endl;
+            s = PREDICT_STREAM_ALL;
+        }
+        stream = (uint32_t)s;
+        std::cout << "✓ El modelo consume el flujo: " << PREDICT_STREAM_NAMES[stream] << std::endl;
     }
     
-    int predict(const float* raw_features) {
+    /**
+     * Predice la clase y, si resp no es nulo, añade el estado de drift del
+     * dispositivo device_id (peticiones v2).
+     */
+    int predict(const float* raw_features, uint32_t device_id = 0, PredictResponse* resp = nullptr) {
         auto start = std::chrono::high_resolution_clock::now();
+        uint64_t t0 = USDT_START(ml_predictor, inference_end);
+        USDT_PROBE1(ml_predictor, inference_start, device_id);
+
+        DriftResult d = drift.observe(device_id, raw_features);
+        if (d.ood) ood_count++;
         
         // Normalizar features
         float normalized[5];
         normalize_features(raw_features, normalized);
         
-        // Crear tensor de entrada
-        std::vector<torch::jit::IValue> inputs;
-        auto options = torch::TensorOptions().dtype(torch::kFloat32);
-        torch::Tensor input_tensor = torch::from_blob(
-            normalized, 
-            {1, 5},  // batch_size=1, features=5
-            options
-        ).clone();  // Clone para evitar problemas de memoria
-        
-        inputs.push_back(input_tensor);
-        
-        // Inferencia
-        torch::Tensor output;
-        {
-            torch::NoGradGuard no_grad;  // Desactivar cálculo de gradientes
-            output = model.forward(inputs).toTensor();
-        }
-        
-        // Obtener clase predicha (argmax)
-        int predicted_class = output.argmax(1).item<int>();
+        int predicted_class = backend->predict(normalized);
+        USDT_PROBE3(ml_predictor, inference_end, device_id, predicted_class, usdt_since(t0));
         
         prediction_count++;
         
@@ -218,7 +319,16 @@ public:
                       << ", size=" << raw_features[2]
                       << ", seq=" << raw_features[3]
                       << ", iops=" << raw_features[4]
+                      << " | OOD: " << ood_count
                       << std::endl;
+            log_drift();
+        }
+
+        if (resp) {
+            resp->pred_class = predicted_class;
+            resp->flags = (d.ood ? PREDICT_RESP_OOD : 0) | (d.drift ? PREDICT_RESP_DRIFT : 0) |
+                          (stream << PREDICT_RESP_STREAM_SHIFT);
+            resp->drift_score = (float)d.psi_max;
         }
         
         return predicted_class;
@@ -227,6 +337,14 @@ public:
     uint64_t get_prediction_count() const {
         return prediction_count;
     }
+
+    uint64_t get_ood_count() const {
+        return ood_count;
+    }
+
+    uint32_t get_stream() const {
+        return stream;
+    }
 };
 
 // ============================================================================
@@ -238,6 +356,8 @@ private:
     MLPredictor* predictor;
     int server_fd;
     bool running;
+    bool stream_mismatch_logged;
+    uint64_t undelivered;      // respuestas a clientes que ya habían cerrado
     
     static PredictorDaemon* instance;
     
@@ -248,14 +368,148 @@ private:
         }
     }
     
+    // Escribe la respuesta entera; false si el cliente ya cerró (se rindió por su plazo)
+    static bool write_full(int fd, const void* buf, size_t len) {
+        size_t sent = 0;
+        while (sent < len) {
+            ssize_t r = send(fd, (const char*)buf + sent, len - sent, MSG_NOSIGNAL);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            sent += (size_t)r;
+        }
+        return true;
+    }
+
+    // Respuesta que el cliente ya no esperaba: se cuenta y se avisa la primera vez
+    void reply(int fd, const void* buf, size_t len) {
+        if (write_full(fd, buf, len)) return;
+        if (undelivered++ == 0)
+            std::cerr << "⚠️  Respuesta no entregada (" << strerror(errno)
+                      << "): el cliente cerró antes de su plazo" << std::endl;
+    }
+
+    // Lee exactamente len bytes (el cliente puede partir la petición)
+    static bool read_full(int fd, void* buf, size_t len) {
+        size_t got = 0;
+        while (got < len) {
+            ssize_t r = read(fd, (char*)buf + got, len - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            got += (size_t)r;
+        }
+        return true;
+    }
+
+    /**
+     * Atiende una petición v1 (5 floats -> 1 int) o v2 (cabecera + floats ->
+     * PredictResponse). Ver predictor_protocol.h.
+     */
+    void handle_client(int client_fd) {
+        // Los 4 primeros bytes son el magic v2 o el primer float de v1
+        uint32_t first;
+        if (!read_full(client_fd, &first, sizeof(first))) {
+            std::cerr << "⚠️  Datos incompletos" << std::endl;
+            return;
+        }
+        uint64_t received_ns = predict_monotonic_ns();
+
+        float raw_features[5];
+        uint32_t device_id = 0;
+        uint32_t stream = PREDICT_STREAM_ALL;
+        bool v2 = (first == PREDICT_V2_MAGIC);
+        bool traced = false;
+        PredictTraceRequest trace = {};
+
+        if (v2) {
+            PredictRequestHeader hdr;
+            hdr.magic = first;
+            if (!read_full(client_fd, (char*)&hdr + sizeof(first), sizeof(hdr) - sizeof(first))) {
+                std::cerr << "⚠️  Cabecera v2 incompleta" << std::endl;
+                return;
+            }
+            if (hdr.version != PREDICT_PROTOCOL_VERSION || hdr.num_features != 5) {
+                std::cerr << "⚠️  Petición v2 no soportada (versión " << hdr.version
+                          << ", " << hdr.num_features << " características)" << std::endl;
+                return;
+            }
+            device_id = hdr.device_id;
+            stream = hdr.flags & PREDICT_STREAM_MASK;
+            if (!predict_stream_valid(stream)) {
+                std::cerr << "⚠️  Petición v2 con flujo inválido (" << stream << ")" << std::endl;
+                return;
+            }
+            if (!read_full(client_fd, raw_features, sizeof(raw_features))) {
+                std::cerr << "⚠️  Datos incompletos" << std::endl;
+                return;
+            }
+            traced = (hdr.flags & PREDICT_REQ_TRACE) && read_full(client_fd, &trace, sizeof(trace));
+        } else {
+            // Leer features (5 floats = 20 bytes)
+            memcpy(raw_features, &first, sizeof(first));
+            if (!read_full(client_fd, (char*)raw_features + sizeof(first),
+                           sizeof(raw_features) - sizeof(first))) {
+                std::cerr << "⚠️  Datos incompletos" << std::endl;
+                return;
+            }
+        }
+        
+        USDT_PROBE3(ml_predictor, request_recv, device_id, stream, v2 ? 2 : 1);
+
+        // Validar características antes de predecir
+        if (!FeatureExtractor::validate_features(raw_features)) {
+            std::cerr << "⚠️  Características inválidas recibidas" << std::endl;
+            return;
+        }
+        
+        if (v2) {
+            PredictResponse resp = {};
+            // Características de otro flujo: no se predice ni se contamina el
+            // monitor de drift; el cliente ve qué flujo consume el modelo
+            if (stream != predictor->get_stream()) {
+                if (!stream_mismatch_logged) {
+                    std::cerr << "⚠️  Petición con flujo " << PREDICT_STREAM_NAMES[stream]
+                              << ", el modelo consume " << PREDICT_STREAM_NAMES[predictor->get_stream()]
+                              << std::endl;
+                    stream_mismatch_logged = true;
+                }
+                resp.flags = PREDICT_RESP_STREAM_MISMATCH |
+                             (predictor->get_stream() << PREDICT_RESP_STREAM_SHIFT);
+                reply(client_fd, &resp, sizeof(resp));
+                return;
+            }
+            predictor->predict(raw_features, device_id, &resp);
+            if (traced) {
+                // Respuesta y traza en un solo send()
+                PredictTraceReply tr = {trace.trace_id, received_ns, predict_monotonic_ns()};
+                resp.flags |= PREDICT_RESP_TRACE;
+                char out[sizeof(resp) + sizeof(tr)];
+                memcpy(out, &resp, sizeof(resp));
+                memcpy(out + sizeof(resp), &tr, sizeof(tr));
+                reply(client_fd, out, sizeof(out));
+            } else {
+                reply(client_fd, &resp, sizeof(resp));
+            }
+            USDT_PROBE2(ml_predictor, response_send, device_id, resp.pred_class);
+        } else {
+            // Enviar respuesta (1 int = 4 bytes)
+            int predicted_class = predictor->predict(raw_features);
+            reply(client_fd, &predicted_class, sizeof(predicted_class));
+            USDT_PROBE2(ml_predictor, response_send, device_id, predicted_class);
+        }
+    }
+    
 public:
-    PredictorDaemon(const std::string& model_path) : server_fd(-1), running(true) {
+    PredictorDaemon(const std::string& model_path) : server_fd(-1), running(true),
+                                                      stream_mismatch_logged(false),
+                                                      undelivered(0) {
         predictor = new MLPredictor(model_path);
         instance = this;
         
         // Manejar señales
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
+        // Un cliente que cerró por su plazo no debe matar al daemon al responderle
+        signal(SIGPIPE, SIG_IGN);
     }
     
     ~PredictorDaemon() {
@@ -300,7 +554,7 @@ public:
         }
         
         // Listen
-        if (listen(server_fd, MAX_CONNECTIONS) < 0) {
+        if (listen(server_fd, LISTEN_BACKLOG) < 0) {
             std::cerr << "❌ Error en listen: " << strerror(errno) << std::endl;
             return false;
         }
@@ -339,34 +593,21 @@ public:
                     continue;
                 }
                 
-                // Leer features (5 floats = 20 bytes)
-                float raw_features[5];
-                ssize_t bytes_read = read(client_fd, raw_features, sizeof(raw_features));
-                
-                if (bytes_read != sizeof(raw_features)) {
-                    std::cerr << "⚠️  Datos incompletos: " << bytes_read << " bytes" << std::endl;
-                    close(client_fd);
-                    continue;
-                }
-                
-                // Validar características antes de predecir
-                if (!FeatureExtractor::validate_features(raw_features)) {
-                    std::cerr << "⚠️  Características inválidas recibidas" << std::endl;
-                    close(client_fd);
-                    continue;
-                }
-                
-                // Predecir
-                int predicted_class = predictor->predict(raw_features);
-                
-                // Enviar respuesta (1 int = 4 bytes)
-                write(client_fd, &predicted_class, sizeof(predicted_class));
-                
+                struct timeval io_timeout;
+                io_timeout.tv_sec = 0;
+                io_timeout.tv_usec = CLIENT_IO_TIMEOUT_MS * 1000;
+                setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, sizeof(io_timeout));
+                setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &io_timeout, sizeof(io_timeout));
+                handle_client(client_fd);
                 close(client_fd);
             }
         }
         
         std::cout << "\n✓ Total de predicciones: " << predictor->get_prediction_count() << std::endl;
+        std::cout << "✓ Entradas fuera de distribución: " << predictor->get_ood_count() << std::endl;
+        if (undelivered)
+            std::cout << "⚠️  Respuestas no entregadas (cliente fuera de plazo): " << undelivered
+                      << std::endl;
         std::cout << "✓ Daemon detenido" << std::endl;
         
         return true;
@@ -380,9 +621,11 @@ PredictorDaemon* PredictorDaemon::instance = nullptr;
 // ============================================================================
 
 int main(int argc, char* argv[]) {
-    std::string model_path = MODEL_PATH_DEFAULT;
+    // Por defecto el bundle del directorio actual; si no existe, el modelo TorchScript
+    std::string model_path = std::ifstream(BUNDLE_PATH_DEFAULT).good() ? BUNDLE_PATH_DEFAULT
+                                                                       : MODEL_PATH_DEFAULT;
     
-    // Permitir especificar ruta del modelo
+    // Permitir especificar ruta del bundle o del modelo
     if (argc > 1) {
         model_path = argv[1];
     }
@@ -0,0 +1,118 @@
+/*
+ * model_bundle.h
+ *
+ * Manifiesto del bundle de modelos (artifacts/bundle.conf).
+ *
+ * Archivo "clave = valor" que escriben los scripts de entrenamiento
+ * (red_neuronal/bundle.py) y lee ml_predictor. Las rutas son relativas al
+ * directorio del manifiesto.
+ *
+ *   backend = torchscript          # o "trees"
+ *   torchscript_model = model_ts.pt
+ *   trees_model = model_trees.txt
+ *   feature_means = ...            # scaler (build_dataset_from_consolidated.py)
+ *   feature_stds = ...
+ *   stream = all                   # flujo de I/O de las características: all, read o write
+ *   features = jump_ratio,...      # características que usa el modelo (feature_plan.h); sin ella, todas
+ *   drift_edges_<i> = ...          # referencia de drift (ver drift_monitor.h)
+ *   drift_ref_<i> = ...
+ */
+
+#pragma once
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#define BUNDLE_MANIFEST_NAME "bundle.conf"
+
+class ModelBundle {
+private:
+    std::string dir;
+    std::map<std::string, std::string> values;
+
+    static std::string trim(const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos) return "";
+        size_t e = s.find_last_not_of(" \t\r\n");
+        return s.substr(b, e - b + 1);
+    }
+
+    static bool ends_with(const std::string& s, const std::string& suffix) {
+        return s.size() >= suffix.size() &&
+               s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+public:
+    /**
+     * Abre un bundle. Acepta el manifiesto, su directorio, o directamente un
+     * archivo de modelo (.pt -> torchscript, .txt -> trees) por compatibilidad.
+     */
+    bool open(const std::string& path) {
+        values.clear();
+
+        std::string manifest;
+        if (ends_with(path, ".conf")) {
+            manifest = path;
+        } else if (std::ifstream(path + "/" BUNDLE_MANIFEST_NAME).good()) {
+            manifest = path + "/" BUNDLE_MANIFEST_NAME;
+        } else {
+            size_t slash = path.rfind('/');
+            dir = (slash == std::string::npos) ? "." : path.substr(0, slash);
+            std::string file = (slash == std::string::npos) ? path : path.substr(slash + 1);
+            if (ends_with(path, ".txt")) {
+                values["backend"] = "trees";
+                values["trees_model"] = file;
+            } else {
+                values["backend"] = "torchscript";
+                values["torchscript_model"] = file;
+            }
+            return true;
+        }
+
+        std::ifstream in(manifest);
+        if (!in.is_open()) return false;
+        size_t slash = manifest.rfind('/');
+        dir = (slash == std::string::npos) ? "." : manifest.substr(0, slash);
+
+        std::string line;
+        while (std::getline(in, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#') continue;
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            values[trim(line.substr(0, eq))] = trim(line.substr(eq + 1));
+        }
+        return true;
+    }
+
+    std::string get(const std::string& key, const std::string& def = "") const {
+        auto it = values.find(key);
+        return it == values.end() ? def : it->second;
+    }
+
+    bool has(const std::string& key) const { return values.count(key) > 0; }
+
+    // Lista de números separados por comas ("1.5,2,inf"); vacía si falta la clave
+    std::vector<float> get_floats(const std::string& key) const {
+        std::vector<float> out;
+        std::stringstream ss(get(key));
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            item = trim(item);
+            if (!item.empty()) out.push_back(std::stof(item));
+        }
+        return out;
+    }
+
+    // Ruta absoluta/relativa al cwd de un archivo referenciado por el bundle
+    std::string path_of(const std::string& key) const {
+        std::string v = get(key);
+        if (v.empty() || v[0] == '/') return v;
+        return dir + "/" + v;
+    }
+
+    std::string backend() const { return get("backend", "torchscript"); }
+};
@@ -0,0 +1,196 @@
+/*
+ * npz_reader.h
+ *
+ * Lector mínimo de archivos .npz de numpy (np.savez / np.savez_compressed)
+ * para las herramientas en C++ que usan data/processed/{train,test}.npz.
+ *
+ * Soporta entradas guardadas sin comprimir o con deflate (zlib) y arrays
+ * C-contiguos de tipo <f4, <f8, <i4 o <i8, que se convierten a float/int64.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+struct NpyArray {
+    std::vector<size_t> shape;
+    std::vector<float> f32;     // relleno si el dtype es flotante
+    std::vector<int64_t> i64;   // relleno si el dtype es entero
+
+    size_t rows() const { return shape.empty() ? 0 : shape[0]; }
+    size_t cols() const { return shape.size() > 1 ? shape[1] : 1; }
+};
+
+class NpzReader {
+private:
+    std::vector<uint8_t> file;
+
+    uint16_t u16(size_t off) const {
+        if (off + 2 > file.size()) throw std::runtime_error("npz: truncated");
+        return (uint16_t)(file[off] | (file[off + 1] << 8));
+    }
+    uint32_t u32(size_t off) const {
+        return (uint32_t)u16(off) | ((uint32_t)u16(off + 2) << 16);
+    }
+    uint64_t u64(size_t off) const {
+        return (uint64_t)u32(off) | ((uint64_t)u32(off + 4) << 32);
+    }
+
+    struct Entry {
+        uint16_t method;
+        uint64_t comp_size;
+        uint64_t size;
+        uint64_t local_offset;
+    };
+    std::map<std::string, Entry> entries;
+
+    void parse_central_directory() {
+        // End Of Central Directory: buscar la firma desde el final
+        if (file.size() < 22) throw std::runtime_error("npz: not a zip file");
+        size_t eocd = std::string::npos;
+        for (size_t i = file.size() - 22; i + 1 > 0; i--) {
+            if (u32(i) == 0x06054b50) { eocd = i; break; }
+            if (i == 0 || file.size() - i > 65557) break;
+        }
+        if (eocd == std::string::npos) throw std::runtime_error("npz: central directory not found");
+
+        uint16_t count = u16(eocd + 10);
+        size_t off = u32(eocd + 16);
+        for (uint16_t n = 0; n < count; n++) {
+            if (u32(off) != 0x02014b50) throw std::runtime_error("npz: bad central directory");
+            Entry e;
+            e.method = u16(off + 10);
+            e.comp_size = u32(off + 20);
+            e.size = u32(off + 24);
+            uint16_t name_len = u16(off + 28);
+            uint16_t extra_len = u16(off + 30);
+            uint16_t comment_len = u16(off + 32);
+            e.local_offset = u32(off + 42);
+            std::string name((const char*)&file[off + 46], name_len);
+
+            // Campos zip64 (numpy usa force_zip64 al escribir)
+            size_t x = off + 46 + name_len, xend = x + extra_len;
+            while (x + 4 <= xend) {
+                uint16_t id = u16(x), len = u16(x + 2);
+                if (id == 0x0001) {
+                    size_t p = x + 4;
+                    if (e.size == 0xFFFFFFFF) { e.size = u64(p); p += 8; }
+                    if (e.comp_size == 0xFFFFFFFF) { e.comp_size = u64(p); p += 8; }
+                    if (e.local_offset == 0xFFFFFFFF) { e.local_offset = u64(p); }
+                }
+                x += 4 + len;
+            }
+            entries[name] = e;
+            off += 46 + name_len + extra_len + comment_len;
+        }
+    }
+
+    std::vector<uint8_t> extract(const Entry& e) const {
+        size_t lh = e.local_offset;
+        if (u32(lh) != 0x04034b50) throw std::runtime_error("npz: bad local header");
+        size_t data = lh + 30 + u16(lh + 26) + u16(lh + 28);
+        if (data + e.comp_size > file.size()) throw std::runtime_error("npz: truncated entry");
+
+        std::vector<uint8_t> out(e.size);
+        if (e.method == 0) {
+            memcpy(out.data(), &file[data], e.size);
+            return out;
+        }
+        if (e.method != 8) throw std::runtime_error("npz: unsupported compression");
+
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) throw std::runtime_error("npz: inflateInit failed");
+        zs.next_in = const_cast<Bytef*>(&file[data]);
+        zs.avail_in = (uInt)e.comp_size;
+        zs.next_out = out.data();
+        zs.avail_out = (uInt)out.size();
+        int rc = inflate(&zs, Z_FINISH);
+        inflateEnd(&zs);
+        if (rc != Z_STREAM_END) throw std::runtime_error("npz: inflate failed");
+        return out;
+    }
+
+    static NpyArray parse_npy(const std::vector<uint8_t>& b) {
+        if (b.size() < 10 || memcmp(b.data(), "\x93NUMPY", 6) != 0)
+            throw std::runtime_error("npy: bad magic");
+        uint8_t major = b[6];
+        size_t hlen, hoff;
+        if (major == 1) { hlen = b[8] | (b[9] << 8); hoff = 10; }
+        else { hlen = b[8] | (b[9] << 8) | (b[10] << 16) | ((size_t)b[11] << 24); hoff = 12; }
+        std::string header((const char*)&b[hoff], hlen);
+
+        if (header.find("'fortran_order': False") == std::string::npos)
+            throw std::runtime_error("npy: only C-order arrays are supported");
+
+        size_t d = header.find("'descr':");
+        size_t q1 = header.find('\'', d + 8), q2 = header.find('\'', q1 + 1);
+        std::string descr = header.substr(q1 + 1, q2 - q1 - 1);
+
+        NpyArray a;
+        size_t s = header.find("'shape':");
+        size_t p1 = header.find('(', s), p2 = header.find(')', p1);
+        std::string dims = header.substr(p1 + 1, p2 - p1 - 1);
+        size_t count = 1;
+        for (size_t pos = 0; pos < dims.size();) {
+            size_t comma = dims.find(',', pos);
+            std::string tok = dims.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            if (tok.find_first_of("0123456789") != std::string::npos) {
+                a.shape.push_back((size_t)std::stoull(tok));
+                count *= a.shape.back();
+            }
+            if (comma == std::string::npos) break;
+            pos = comma + 1;
+        }
+
+        const uint8_t* data = &b[hoff + hlen];
+        size_t avail = b.size() - hoff - hlen;
+        auto need = [&](size_t elem) {
+            if (count * elem > avail) throw std::runtime_error("npy: truncated data");
+        };
+
+        if (descr == "<f4") {
+            need(4);
+            a.f32.resize(count);
+            memcpy(a.f32.data(), data, count * 4);
+        } else if (descr == "<f8") {
+            need(8);
+            a.f32.resize(count);
+            for (size_t i = 0; i < count; i++) { double v; memcpy(&v, data + 8 * i, 8); a.f32[i] = (float)v; }
+        } else if (descr == "<i8") {
+            need(8);
+            a.i64.resize(count);
+            memcpy(a.i64.data(), data, count * 8);
+        } else if (descr == "<i4") {
+            need(4);
+            a.i64.resize(count);
+            for (size_t i = 0; i < count; i++) { int32_t v; memcpy(&v, data + 4 * i, 4); a.i64[i] = v; }
+        } else {
+            throw std::runtime_error("npy: unsupported dtype " + descr);
+        }
+        return a;
+    }
+
+public:
+    void open(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) throw std::runtime_error("npz: cannot open " + path);
+        file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        entries.clear();
+        parse_central_directory();
+    }
+
+    // Devuelve el array "name" (sin la extensión .npy)
+    NpyArray get(const std::string& name) const {
+        auto it = entries.find(name + ".npy");
+        if (it == entries.end()) throw std::runtime_error("npz: missing array " + name);
+        return parse_npy(extract(it->second));
+    }
+};
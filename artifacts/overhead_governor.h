@@ -0,0 +1,176 @@
+/*
+ * overhead_governor.h
+ *
+ * Gobernador del coste de trazado: mantiene el coste total del colector
+ * (programas BPF + CPU del proceso, ver bpf_overhead.h) bajo un presupuesto
+ * expresado en % de la CPU total del host, eligiendo por dispositivo uno de
+ * tres modos:
+ *
+ *   full       cada I/O se envía al espacio de usuario (perf buffer)
+ *   sampled    el programa BPF agrega la ventana en el kernel y envía solo
+ *              1 de cada 2^GOV_SAMPLE_SHIFT eventos (curva de fallos, etc.)
+ *   aggregate  solo el agregado en el kernel
+ *
+ * El coste de cada dispositivo se predice con dos costes por evento que se
+ * estiman continuamente: el de los programas BPF (se paga en todos los
+ * modos) y el del espacio de usuario por evento enviado. Si la predicción
+ * total supera el presupuesto se degrada el dispositivo cuyo cambio ahorra
+ * más; tras GOV_PROMOTE_WINDOWS ventanas por debajo de GOV_PROMOTE_FRACTION
+ * del presupuesto se restaura un dispositivo por ventana, el más barato.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GOV_SAMPLE_SHIFT 4            // sampled: 1 de cada 16 eventos
+#define GOV_PROMOTE_FRACTION 0.5      // margen para volver a un modo más caro
+#define GOV_PROMOTE_WINDOWS 3
+#define GOV_COST_ALPHA 0.3            // EWMA de los costes por evento
+#define GOV_MAX_DEVICES 64
+
+enum TraceMode {
+    TRACE_FULL = 0,
+    TRACE_SAMPLED = 1,
+    TRACE_AGGREGATE = 2
+};
+
+static const char* const TRACE_MODE_NAMES[3] = {"full", "sampled", "aggregate"};
+
+struct GovernorChange {
+    uint32_t dev;
+    int from;
+    int to;
+};
+
+class OverheadGovernor {
+private:
+    struct Device {
+        int mode;
+        uint64_t events;      // eventos de la última ventana
+    };
+
+    double budget_frac;       // fracción de la CPU total del host
+    int ncpus;
+    double bpf_ns_per_event;
+    double user_ns_per_event;
+    int calm_windows;
+    std::map<uint32_t, Device> devices;
+
+    static double streamed_fraction(int mode) {
+        if (mode == TRACE_FULL) return 1.0;
+        if (mode == TRACE_SAMPLED) return 1.0 / (1 << GOV_SAMPLE_SHIFT);
+        return 0.0;
+    }
+
+    double cost(uint64_t events, int mode) const {
+        return (double)events * (bpf_ns_per_event + user_ns_per_event * streamed_fraction(mode));
+    }
+
+    static double ewma(double prev, double sample) {
+        return prev <= 0.0 ? sample : prev + GOV_COST_ALPHA * (sample - prev);
+    }
+
+public:
+    OverheadGovernor(double budget_pct, int cpus)
+        : budget_frac(budget_pct / 100.0), ncpus(cpus > 0 ? cpus : 1),
+          bpf_ns_per_event(0.0), user_ns_per_event(0.0), calm_windows(0) {}
+
+    int mode_of(uint32_t dev) const {
+        auto it = devices.find(dev);
+        return it == devices.end() ? TRACE_FULL : it->second.mode;
+    }
+
+    const std::map<uint32_t, Device>& all() const { return devices; }
+
+    double budget_pct() const { return budget_frac * 100.0; }
+
+    // Coste previsto (ns) de la última ventana con los modos actuales
+    double predicted_ns() const {
+        double total = 0.0;
+        for (const auto& kv : devices) total += cost(kv.second.events, kv.second.mode);
+        return total;
+    }
+
+    /**
+     * Ajusta los modos tras una ventana.
+     *
+     * @param dev_events Eventos de bloque por dispositivo vistos por BPF
+     * @param bpf_ns Tiempo total de los programas BPF en la ventana
+     * @param cpu_ns CPU del proceso colector en la ventana
+     * @param streamed Eventos que llegaron al espacio de usuario
+     * @param wall_s Duración real de la ventana
+     * @return Cambios de modo a aplicar en el mapa trace_ctl
+     */
+    std::vector<GovernorChange> update(const std::map<uint32_t, uint64_t>& dev_events,
+                                       uint64_t bpf_ns, uint64_t cpu_ns, uint64_t streamed,
+                                       double wall_s) {
+        std::vector<GovernorChange> changes;
+        uint64_t total_events = 0;
+        for (auto& kv : devices) kv.second.events = 0;
+        for (const auto& kv : dev_events) {
+            devices.emplace(kv.first, Device{TRACE_FULL, 0}).first->second.events = kv.second;
+            total_events += kv.second;
+        }
+        if (total_events > 0) bpf_ns_per_event = ewma(bpf_ns_per_event, (double)bpf_ns / total_events);
+        if (streamed > 0) user_ns_per_event = ewma(user_ns_per_event, (double)cpu_ns / streamed);
+        if (wall_s <= 0.0 || total_events == 0) return changes;
+
+        double budget = budget_frac * ncpus * wall_s * 1e9;
+        double total = predicted_ns();
+
+        // Por encima: degradar hasta caber (o hasta que no quede nada que degradar)
+        while (total > budget) {
+            uint32_t best = 0;
+            double best_gain = 0.0;
+            for (const auto& kv : devices) {
+                const Device& d = kv.second;
+                if (d.mode == TRACE_AGGREGATE || d.events == 0) continue;
+                double gain = cost(d.events, d.mode) - cost(d.events, d.mode + 1);
+                if (gain > best_gain) {
+                    best_gain = gain;
+                    best = kv.first;
+                }
+            }
+            if (best_gain <= 0.0) break;
+            Device& d = devices[best];
+            changes.push_back({best, d.mode, d.mode + 1});
+            d.mode++;
+            total -= best_gain;
+        }
+        if (!changes.empty()) {
+            calm_windows = 0;
+            return changes;
+        }
+
+        // Por debajo con margen: restaurar un dispositivo, el más barato
+        if (total >= GOV_PROMOTE_FRACTION * budget) {
+            calm_windows = 0;
+            return changes;
+        }
+        if (++calm_windows < GOV_PROMOTE_WINDOWS) return changes;
+
+        uint32_t best = 0;
+        double best_extra = -1.0;
+        for (const auto& kv : devices) {
+            const Device& d = kv.second;
+            if (d.mode == TRACE_FULL) continue;
+            double extra = cost(d.events, d.mode - 1) - cost(d.events, d.mode);
+            if (best_extra < 0.0 || extra < best_extra) {
+                best_extra = extra;
+                best = kv.first;
+            }
+        }
+        if (best_extra >= 0.0 && total + best_extra < GOV_PROMOTE_FRACTION * budget) {
+            Device& d = devices[best];
+            changes.push_back({best, d.mode, d.mode - 1});
+            d.mode--;
+            calm_windows = 0;
+        }
+        return changes;
+    }
+};
@@ -0,0 +1,233 @@
+/*
+ * predictor_client.h
+ *
+ * Cliente del socket Unix del daemon ml_predictor, compartido por el
+ * colector eBPF y las herramientas offline.
+ *
+ * Protocolo: ver predictor_protocol.h. predictor_request habla v1 (5 floats
+ * -> 1 int); predictor_request_v2 identifica el dispositivo y recibe además
+ * los indicadores de drift.
+ *
+ * Con deadline_ms > 0 toda la petición (connect, send y recv) queda acotada
+ * en el tiempo: el socket es no bloqueante y cada paso espera con poll()
+ * solo lo que queda del plazo.
+ */
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "predictor_protocol.h"
+
+// Códigos de error de predictor_request* (las clases válidas son >= 0)
+#define PREDICT_ERR_UNAVAILABLE -1   // daemon caído o socket inexistente
+#define PREDICT_ERR_DEADLINE    -2   // el daemon no respondió a tiempo
+#define PREDICT_ERR_PROTOCOL    -3   // respuesta incompleta
+#define PREDICT_ERR_BACKLOG     -4   // backlog de listen() lleno: connect() rechazado
+
+// Espera un evento en el socket hasta el deadline; false si vence
+static inline bool predictor_wait(int sock, short events,
+                                  std::chrono::steady_clock::time_point deadline,
+                                  bool bounded) {
+    int timeout_ms = -1;
+    if (bounded) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return false;
+        timeout_ms = (int)left;
+    }
+    struct pollfd pfd = {sock, events, 0};
+    int rc;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc > 0;
+}
+
+/**
+ * Envía una petición ya serializada y lee una respuesta de hasta resp_len
+ * bytes. Si el daemon cierra la conexión tras resp_min bytes (0 = resp_len)
+ * la respuesta se da por completa.
+ *
+ * @return Bytes recibidos (>= 0) o uno de los códigos PREDICT_ERR_*
+ */
+static inline int predictor_exchange(const std::string& sock_path,
+                                     const void* req, size_t req_len,
+                                     void* resp, size_t resp_len,
+                                     std::string* err, int deadline_ms,
+                                     size_t resp_min = 0) {
+    if (resp_min == 0) resp_min = resp_len;
+    bool bounded = deadline_ms > 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(deadline_ms);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | (bounded ? SOCK_NONBLOCK : 0), 0);
+    if (sock < 0) {
+        if (err) *err = std::string("socket() failed: ") + strerror(errno);
+        return PREDICT_ERR_UNAVAILABLE;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        // En sockets Unix no bloqueantes EAGAIN significa backlog lleno
+        int rc = errno == EAGAIN ? PREDICT_ERR_BACKLOG : PREDICT_ERR_UNAVAILABLE;
+        if (err) *err = std::string("connect() failed: ") + strerror(errno);
+        close(sock);
+        return rc;
+    }
+
+    if (!predictor_wait(sock, POLLOUT, deadline, bounded)) {
+        if (err) *err = "deadline exceeded before send()";
+        close(sock);
+        return PREDICT_ERR_DEADLINE;
+    }
+    ssize_t s = send(sock, req, req_len, MSG_NOSIGNAL);
+    if (s != (ssize_t)req_len) {
+        if (err) *err = "send() failed or partial send";
+        close(sock);
+        return PREDICT_ERR_UNAVAILABLE;
+    }
+
+    size_t got = 0;
+    while (got < resp_len) {
+        if (!predictor_wait(sock, POLLIN, deadline, bounded)) {
+            if (err) *err = "deadline exceeded waiting for prediction";
+            close(sock);
+            return PREDICT_ERR_DEADLINE;
+        }
+        ssize_t r = recv(sock, (char*)resp + got, resp_len - got, 0);
+        if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+        if (r == 0 && got >= resp_min) break;
+        if (r <= 0) {
+            if (err) *err = "recv() failed";
+            close(sock);
+            return PREDICT_ERR_PROTOCOL;
+        }
+        got += (size_t)r;
+    }
+
+    close(sock);
+    return (int)got;
+}
+
+/**
+ * Envía un vector de características al daemon (protocolo v1) y devuelve la clase.
+ *
+ * @param sock_path Ruta del socket Unix del daemon
+ * @param f Array de 5 características sin normalizar
+ * @param err Si no es nulo, recibe la descripción del error
+ * @param deadline_ms Plazo total de la petición (0 = sin límite)
+ * @return Clase predicha (>= 0) o uno de los códigos PREDICT_ERR_*
+ */
+static inline int predictor_request(const std::string& sock_path, const float* f,
+                                    std::string* err = nullptr, int deadline_ms = 0) {
+    int pred = -1;
+    int rc = predictor_exchange(sock_path, f, PREDICT_V1_REQUEST_BYTES,
+                                &pred, sizeof(pred), err, deadline_ms);
+    return rc < 0 ? rc : pred;
+}
+
+/**
+ * Petición v2: además de la clase devuelve los flags de drift del daemon
+ * para el dispositivo indicado.
+ *
+ * @param device_id dev_t del dispositivo (ver device_id_of)
+ * @param resp Respuesta completa (clase, flags PREDICT_RESP_*, drift_score)
+ * @param stream Flujo de I/O de las características (PREDICT_STREAM_*)
+ * @param trace Si no es nulo se pide traza: se rellena sent_ns y trace_reply
+ *              recibe las marcas del daemon (todo a 0 si no las envía)
+ * @return Clase predicha (>= 0) o uno de los códigos PREDICT_ERR_*
+ */
+static inline int predictor_request_v2(const std::string& sock_path, uint32_t device_id,
+                                       const float* f, int num_features,
+                                       PredictResponse* resp,
+                                       std::string* err = nullptr, int deadline_ms = 0,
+                                       uint32_t stream = PREDICT_STREAM_ALL,
+                                       PredictTraceRequest* trace = nullptr,
+                                       PredictTraceReply* trace_reply = nullptr) {
+    if (num_features <= 0 || num_features > PREDICT_MAX_FEATURES) {
+        if (err) *err = "invalid feature count";
+        return PREDICT_ERR_PROTOCOL;
+    }
+    char buf[sizeof(PredictRequestHeader) + PREDICT_MAX_FEATURES * sizeof(float) +
+             sizeof(PredictTraceRequest)];
+    PredictRequestHeader hdr = {};
+    hdr.magic = PREDICT_V2_MAGIC;
+    hdr.version = PREDICT_PROTOCOL_VERSION;
+    hdr.num_features = (uint16_t)num_features;
+    hdr.device_id = device_id;
+    hdr.flags = (stream & PREDICT_STREAM_MASK) | (trace ? PREDICT_REQ_TRACE : 0);
+    memcpy(buf, &hdr, sizeof(hdr));
+    size_t len = sizeof(hdr);
+    memcpy(buf + len, f, num_features * sizeof(float));
+    len += num_features * sizeof(float);
+    if (trace) {
+        trace->sent_ns = predict_monotonic_ns();
+        memcpy(buf + len, trace, sizeof(*trace));
+        len += sizeof(*trace);
+    }
+
+    // Respuesta y, si el daemon la envía, la traza a continuación
+    char rbuf[sizeof(PredictResponse) + sizeof(PredictTraceReply)];
+    memset(rbuf, 0, sizeof(rbuf));
+    int rc = predictor_exchange(sock_path, buf, len, rbuf,
+                                trace ? sizeof(rbuf) : sizeof(*resp), err, deadline_ms,
+                                sizeof(*resp));
+    memcpy(resp, rbuf, sizeof(*resp));
+    if (trace_reply) {
+        memset(trace_reply, 0, sizeof(*trace_reply));
+        if (rc == (int)sizeof(rbuf) && (resp->flags & PREDICT_RESP_TRACE))
+            memcpy(trace_reply, rbuf + sizeof(*resp), sizeof(*trace_reply));
+    }
+    return rc < 0 ? rc : resp->pred_class;
+}
+
+/**
+ * dev_t de un dispositivo de bloque (/sys/class/block/<dev>/dev = "maj:min")
+ * codificado como MKDEV del kernel, el mismo valor que args->dev en los
+ * tracepoints de bloque. 0 si no existe.
+ */
+static inline uint32_t device_id_of(const std::string& dev) {
+    std::ifstream in("/sys/class/block/" + dev + "/dev");
+    unsigned major = 0, minor = 0;
+    char colon = 0;
+    if (!(in >> major >> colon >> minor) || colon != ':') return 0;
+    return (major << 20) | minor;
+}
+
+// ============================================================================
+// CLASIFICADOR HEURÍSTICO DE RESPALDO
+// ============================================================================
+
+#define HEURISTIC_SEQ_RATIO_HIGH   0.80f      // mayoría de accesos contiguos
+#define HEURISTIC_SEQ_RATIO_LOW    0.30f      // mayoría de saltos > umbral
+#define HEURISTIC_LARGE_IO_BYTES   65536.0f   // peticiones grandes (>= 64 KB)
+#define HEURISTIC_SMALL_IO_BYTES   16384.0f   // peticiones pequeñas (<= 16 KB)
+
+/**
+ * Clasificación barata con umbrales sobre seq_ratio y avg_io_bytes, para
+ * cuando el daemon no está disponible o no responde dentro del plazo.
+ * Devuelve 0=sequential, 1=random, 2=mixed (mismo mapeo que el modelo).
+ */
+static inline int heuristic_classify(const float* f) {
+    float avg_io_bytes = f[2];
+    float seq_ratio = f[3];
+    if (seq_ratio >= HEURISTIC_SEQ_RATIO_HIGH && avg_io_bytes >= HEURISTIC_LARGE_IO_BYTES)
+        return 0;
+    if (seq_ratio <= HEURISTIC_SEQ_RATIO_LOW ||
+        (seq_ratio < HEURISTIC_SEQ_RATIO_HIGH && avg_io_bytes <= HEURISTIC_SMALL_IO_BYTES))
+        return 1;
+    return 2;
+}
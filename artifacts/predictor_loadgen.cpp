@@ -0,0 +1,460 @@
+/*
+ * predictor_loadgen.cpp
+ *
+ * Generador de carga para el daemon ml_predictor: cuántas ventanas por
+ * segundo sostiene un daemon que atiende a muchos contenedores.
+ *
+ * Reproduce vectores de características reales contra el socket Unix con
+ * varias peticiones en vuelo (una conexión por petición, como el colector)
+ * y mide throughput, percentiles de latencia y errores. Las
+ * características salen de test.npz (normalizado: se des-normaliza con el
+ * scaler del bundle, que es lo que el daemon espera recibir) o de un CSV
+ * de características del colector (--features-out / --replay).
+ *
+ * Modos:
+ *   --rate 0      lazo cerrado: cada conexión envía en cuanto recibe
+ *   --rate R      lazo abierto a R peticiones/s; la latencia se mide desde
+ *                 el instante programado, así que incluye la espera en cola
+ *                 cuando el daemon no da abasto
+ *   --ramp        escalones de --rate multiplicados por --step hasta la
+ *                 saturación (throughput < 90% de lo admitido, errores > 1%
+ *                 o p99 por encima del plazo). Los connect() rechazados por
+ *                 el backlog del socket se cuentan aparte: miden la cola de
+ *                 listen(), no la inferencia, así que cortan la rampa como
+ *                 resultado no concluyente en lugar de dar ese punto como
+ *                 saturación; igual si el daemon deja de aceptar conexiones
+ *
+ * Las respuestas "el modelo consume otro flujo" no pasan por el modelo: no
+ * cuentan como correctas ni entran en los percentiles, y la medida se
+ * aborta indicando el --stream que espera el daemon.
+ *
+ * Uso:
+ *   ./predictor_loadgen --data ../data/processed/test.npz --bundle bundle.conf \
+ *                       --connections 16 --rate 500 --ramp --duration 10
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+
+#include "window_features.h"
+#include "predictor_client.h"
+#include "model_bundle.h"
+#include "npz_reader.h"
+
+// ============================================================================
+// CONFIG
+// ============================================================================
+
+#define DEFAULT_SOCK_PATH "/tmp/ml_predictor.sock"
+#define DEFAULT_BUNDLE "./bundle.conf"
+#define DEFAULT_CONNECTIONS 8
+#define DEFAULT_DURATION_S 10
+#define DEFAULT_DEADLINE_MS 1000
+#define DEFAULT_RAMP_STEP 2.0
+#define MAX_RAMP_STEPS 20
+
+// Criterios de saturación de un escalón
+#define SATURATION_THROUGHPUT 0.90   // fracción del objetivo alcanzada
+#define SATURATION_ERRORS 0.01       // fracción de peticiones con error
+
+// ============================================================================
+// ENTRADA
+// ============================================================================
+
+// test.npz está normalizado con el scaler del bundle: raw = x * std + mean
+static bool load_npz(const std::string& path, const ModelBundle& bundle,
+                     std::vector<std::vector<float>>* rows) {
+    std::vector<float> means = bundle.get_floats("feature_means");
+    std::vector<float> stds = bundle.get_floats("feature_stds");
+    if (means.size() != NUM_FEATURES || stds.size() != NUM_FEATURES) {
+        std::cerr << "ERROR: bundle has no feature_means/feature_stds to de-normalize " << path << "\n";
+        return false;
+    }
+    NpyArray X;
+    try {
+        NpzReader npz;
+        npz.open(path);
+        X = npz.get("X");
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return false;
+    }
+    if (X.f32.empty() || X.cols() != NUM_FEATURES) {
+        std::cerr << "ERROR: expected float X with " << NUM_FEATURES << " columns in " << path << "\n";
+        return false;
+    }
+    for (size_t r = 0; r < X.rows(); r++) {
+        std::vector<float> f(NUM_FEATURES);
+        for (int i = 0; i < NUM_FEATURES; i++)
+            f[i] = X.f32[r * NUM_FEATURES + i] * stds[i] + means[i];
+        rows->push_back(f);
+    }
+    return true;
+}
+
+// CSV del colector: las NUM_FEATURES últimas columnas son las características
+static bool load_features_csv(const std::string& path, std::vector<std::vector<float>>* rows) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "ERROR: Cannot open " << path << "\n";
+        return false;
+    }
+    std::string line;
+    std::getline(in, line);    // cabecera
+    while (std::getline(in, line)) {
+        std::vector<float> cols;
+        std::stringstream ss(line);
+        std::string item;
+        while (std::getline(ss, item, ',')) cols.push_back(strtof(item.c_str(), nullptr));
+        if (cols.size() < NUM_FEATURES) continue;
+        rows->push_back(std::vector<float>(cols.end() - NUM_FEATURES, cols.end()));
+    }
+    return true;
+}
+
+// ============================================================================
+// RESULTADOS
+// ============================================================================
+
+struct StepResult {
+    double target_rate;        // 0 = lazo cerrado
+    double duration_s;
+    uint64_t sent;
+    uint64_t ok;
+    uint64_t unavailable;
+    uint64_t refused;          // connect() rechazado con el backlog lleno
+    uint64_t deadline;
+    uint64_t protocol;
+    uint64_t mismatch;         // el modelo consume otro flujo (sin inferencia)
+    uint32_t model_stream;     // flujo del modelo según esas respuestas
+    double throughput;         // respuestas correctas por segundo
+    double p50_us, p90_us, p99_us, p999_us, max_us;
+
+    uint64_t admitted() const { return sent - refused; }
+
+    // Errores sobre las peticiones admitidas (sin los rechazos del backlog)
+    double error_rate() const {
+        return admitted() ? (double)(unavailable + deadline + protocol) / admitted() : 0.0;
+    }
+
+    double refused_rate() const { return sent ? (double)refused / sent : 0.0; }
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    size_t k = (size_t)(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+// ============================================================================
+// GENERADOR
+// ============================================================================
+
+class LoadGenerator {
+private:
+    std::string sock_path;
+    const std::vector<std::vector<float>>& rows;
+    int connections;
+    int devices;               // dev_t distintos, uno por contenedor simulado
+    int deadline_ms;
+    uint32_t stream;
+
+    struct Worker {
+        std::vector<double> lat_us;
+        uint64_t sent, ok, unavailable, refused, deadline, protocol, mismatch;
+        uint32_t model_stream;
+    };
+
+    void run_worker(int id, double rate, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end, Worker* w) {
+        // Lazo abierto: cada conexión lleva rate/connections peticiones/s,
+        // desfasadas para no llegar todas a la vez
+        double interval_s = rate > 0.0 ? connections / rate : 0.0;
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(interval_s));
+        auto next = start + interval * id / connections;
+        size_t row = (size_t)id * 7919 % rows.size();
+
+        while (true) {
+            auto now = std::chrono::steady_clock::now();
+            if (rate > 0.0) {
+                if (next >= end) break;
+                if (next > now) std::this_thread::sleep_until(next);
+            } else {
+                if (now >= end) break;
+                next = now;
+            }
+
+            const std::vector<float>& f = rows[row];
+            row = (row + 1) % rows.size();
+            uint32_t dev = (uint32_t)(1 + (row % devices));   // minor 1..devices
+            PredictResponse resp;
+            int pred = predictor_request_v2(sock_path, dev, f.data(), NUM_FEATURES,
+                                            &resp, nullptr, deadline_ms, stream);
+            auto done = std::chrono::steady_clock::now();
+            w->sent++;
+            if (pred == PREDICT_ERR_UNAVAILABLE) w->unavailable++;
+            else if (pred == PREDICT_ERR_BACKLOG) w->refused++;
+            else if (pred == PREDICT_ERR_DEADLINE) w->deadline++;
+            else if (pred < 0) w->protocol++;
+            else if (resp.flags & PREDICT_RESP_STREAM_MISMATCH) {
+                // Respuesta sin inferencia: ni throughput ni latencia
+                uint32_t s = predict_resp_stream(resp.flags);
+                if (predict_stream_valid(s)) {
+                    w->mismatch++;
+                    w->model_stream = s;
+                } else {
+                    w->protocol++;
+                }
+            } else {
+                w->ok++;
+                w->lat_us.push_back(std::chrono::duration<double, std::micro>(done - next).count());
+            }
+            if (rate > 0.0) next += interval;
+        }
+    }
+
+public:
+    LoadGenerator(const std::string& sock, const std::vector<std::vector<float>>& r,
+                  int conns, int devs, int deadline, uint32_t s)
+        : sock_path(sock), rows(r), connections(conns), devices(devs),
+          deadline_ms(deadline), stream(s) {}
+
+    StepResult run_step(double rate, double duration_s) {
+        std::vector<Worker> workers(connections, Worker{{}, 0, 0, 0, 0, 0, 0, 0, PREDICT_STREAM_ALL});
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(duration_s));
+        for (int i = 0; i < connections; i++)
+            threads.emplace_back(&LoadGenerator::run_worker, this, i, rate, start, end, &workers[i]);
+        for (auto& t : threads) t.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        StepResult r = {};
+        r.target_rate = rate;
+        r.duration_s = elapsed;
+        std::vector<double> lat;
+        for (Worker& w : workers) {
+            r.sent += w.sent;
+            r.ok += w.ok;
+            r.unavailable += w.unavailable;
+            r.refused += w.refused;
+            r.deadline += w.deadline;
+            r.protocol += w.protocol;
+            r.mismatch += w.mismatch;
+            if (w.mismatch) r.model_stream = w.model_stream;
+            lat.insert(lat.end(), w.lat_us.begin(), w.lat_us.end());
+        }
+        r.throughput = elapsed > 0 ? r.ok / elapsed : 0.0;
+        r.p50_us = percentile(lat, 0.50);
+        r.p90_us = percentile(lat, 0.90);
+        r.p99_us = percentile(lat, 0.99);
+        r.p999_us = percentile(lat, 0.999);
+        r.max_us = lat.empty() ? 0.0 : *std::max_element(lat.begin(), lat.end());
+        return r;
+    }
+};
+
+static void print_header(bool csv) {
+    if (csv) {
+        std::cout << "target_rate,throughput,sent,ok,unavailable,refused,deadline,protocol,mismatch,"
+                     "p50_us,p90_us,p99_us,p999_us,max_us\n";
+        return;
+    }
+    std::cout << std::right << std::setw(10) << "target/s" << std::setw(12) << "achieved/s"
+              << std::setw(9) << "errors" << std::setw(11) << "p50_us" << std::setw(11) << "p90_us"
+              << std::setw(11) << "p99_us" << std::setw(11) << "p999_us" << std::setw(11) << "max_us"
+              << "\n";
+}
+
+static void print_step(const StepResult& r, bool csv) {
+    if (csv) {
+        std::cout << r.target_rate << "," << r.throughput << "," << r.sent << "," << r.ok << ","
+                  << r.unavailable << "," << r.refused << "," << r.deadline << "," << r.protocol << "," << r.mismatch
+                  << "," << r.p50_us << "," << r.p90_us << "," << r.p99_us << "," << r.p999_us
+                  << "," << r.max_us << "\n";
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(1) << std::right << std::setw(10);
+    if (r.target_rate > 0) std::cout << r.target_rate;
+    else std::cout << "closed";
+    std::cout << std::setw(12) << r.throughput << std::setw(8) << 100.0 * r.error_rate() << "%"
+              << std::setw(11) << r.p50_us << std::setw(11) << r.p90_us << std::setw(11) << r.p99_us
+              << std::setw(11) << r.p999_us << std::setw(11) << r.max_us << "\n";
+    if (r.unavailable || r.refused || r.deadline || r.protocol || r.mismatch)
+        std::cout << "           unavailable=" << r.unavailable << " refused=" << r.refused
+                  << " deadline=" << r.deadline
+                  << " protocol=" << r.protocol << " stream_mismatch=" << r.mismatch << "\n";
+}
+
+// Con otro flujo que el del modelo no se mide la inferencia: abortar
+static bool check_stream(const StepResult& r) {
+    if (!r.mismatch) return true;
+    std::cerr << "ERROR: " << r.mismatch << " replies without inference: the daemon's model consumes the "
+              << PREDICT_STREAM_NAMES[r.model_stream] << " stream; rerun with --stream "
+              << PREDICT_STREAM_NAMES[r.model_stream] << "\n";
+    return false;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::string sock_path = DEFAULT_SOCK_PATH;
+    std::string bundle_path = DEFAULT_BUNDLE;
+    std::string data_path;
+    std::string features_path;
+    int connections = DEFAULT_CONNECTIONS;
+    int devices = 1;
+    double rate = 0.0;
+    double duration_s = DEFAULT_DURATION_S;
+    int deadline_ms = DEFAULT_DEADLINE_MS;
+    bool ramp = false;
+    double step = DEFAULT_RAMP_STEP;
+    std::string stream_name = "all";
+    bool csv = false;
+
+    static struct option long_opts[] = {
+        {"sock", required_argument, 0, 's'},
+        {"bundle", required_argument, 0, 'b'},
+        {"data", required_argument, 0, 'd'},
+        {"features", required_argument, 0, 'f'},
+        {"connections", required_argument, 0, 'c'},
+        {"devices", required_argument, 0, 'D'},
+        {"rate", required_argument, 0, 'r'},
+        {"duration", required_argument, 0, 't'},
+        {"deadline-ms", required_argument, 0, 'T'},
+        {"ramp", no_argument, 0, 'R'},
+        {"step", required_argument, 0, 'S'},
+        {"stream", required_argument, 0, 'M'},
+        {"csv", no_argument, 0, 'C'},
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:b:d:f:c:r:t:h", long_opts, nullptr)) != -1) {
+        if (opt == 's') sock_path = optarg;
+        else if (opt == 'b') bundle_path = optarg;
+        else if (opt == 'd') data_path = optarg;
+        else if (opt == 'f') features_path = optarg;
+        else if (opt == 'c') connections = std::max(1, atoi(optarg));
+        else if (opt == 'D') devices = std::max(1, atoi(optarg));
+        else if (opt == 'r') rate = std::max(0.0, atof(optarg));
+        else if (opt == 't') duration_s = std::max(0.1, atof(optarg));
+        else if (opt == 'T') deadline_ms = std::max(0, atoi(optarg));
+        else if (opt == 'R') ramp = true;
+        else if (opt == 'S') step = std::max(1.1, atof(optarg));
+        else if (opt == 'M') stream_name = optarg;
+        else if (opt == 'C') csv = true;
+        else if (opt == 'h') {
+            std::cout << "Usage: " << argv[0] << " (--data <npz> | --features <csv>) [options]\n"
+                      << "  -s, --sock <path>         Predictor socket (default: " DEFAULT_SOCK_PATH ")\n"
+                      << "  -b, --bundle <path>       Bundle with the scaler to de-normalize --data\n"
+                      << "                            (default: " DEFAULT_BUNDLE ")\n"
+                      << "  -d, --data <npz>          Normalized test set (data/processed/test.npz)\n"
+                      << "  -f, --features <csv>      Raw features CSV from ebpf_block_trace --features-out\n"
+                      << "  -c, --connections <n>     Requests in flight (default: 8)\n"
+                      << "      --devices <n>         Distinct device ids, one per simulated container\n"
+                      << "                            (default: 1)\n"
+                      << "  -r, --rate <req/s>        Open-loop rate; 0 = closed loop (default: 0)\n"
+                      << "  -t, --duration <s>        Seconds per step (default: 10)\n"
+                      << "      --deadline-ms <ms>    Per-request deadline (default: 1000)\n"
+                      << "      --ramp                Multiply --rate by --step until saturation\n"
+                      << "      --step <x>            Ramp factor (default: 2)\n"
+                      << "      --stream <s>          Feature stream sent: all, read or write (default: all)\n"
+                      << "      --csv                 CSV output\n"
+                      << "  -h, --help                Show this help\n";
+            return 0;
+        }
+    }
+
+    int stream = parse_predict_stream(stream_name);
+    if (stream < 0) {
+        std::cerr << "ERROR: invalid --stream " << stream_name << "\n";
+        return 1;
+    }
+    if (ramp && rate <= 0.0) {
+        std::cerr << "ERROR: --ramp needs a starting --rate\n";
+        return 1;
+    }
+
+    std::vector<std::vector<float>> rows;
+    if (!features_path.empty()) {
+        if (!load_features_csv(features_path, &rows)) return 1;
+    } else if (!data_path.empty()) {
+        ModelBundle bundle;
+        if (!bundle.open(bundle_path)) {
+            std::cerr << "ERROR: cannot open bundle " << bundle_path << "\n";
+            return 1;
+        }
+        if (!load_npz(data_path, bundle, &rows)) return 1;
+    } else {
+        std::cerr << "ERROR: --data or --features is required\n";
+        return 1;
+    }
+    if (rows.empty()) {
+        std::cerr << "ERROR: no feature vectors loaded\n";
+        return 1;
+    }
+    std::cerr << "Loaded " << rows.size() << " feature vectors; " << connections
+              << " connections, " << devices << " devices\n";
+
+    LoadGenerator gen(sock_path, rows, connections, devices, deadline_ms, (uint32_t)stream);
+    print_header(csv);
+
+    if (!ramp) {
+        StepResult r = gen.run_step(rate, duration_s);
+        print_step(r, csv);
+        if (!check_stream(r)) return 1;
+        return r.ok ? 0 : 1;
+    }
+
+    // Escalones hasta que el daemon deja de seguir el ritmo
+    double best = 0.0;
+    for (int i = 0; i < MAX_RAMP_STEPS; i++, rate *= step) {
+        StepResult r = gen.run_step(rate, duration_s);
+        print_step(r, csv);
+        if (!check_stream(r)) return 1;
+        if (r.refused_rate() > SATURATION_ERRORS) {
+            std::cerr << "Inconclusive: " << std::fixed << std::setprecision(1)
+                      << 100.0 * r.refused_rate() << "% of connects refused at " << rate
+                      << " req/s (listen backlog full, last sustained " << best
+                      << " req/s); lower --connections or raise the daemon's backlog\n";
+            return 1;
+        }
+        // "unavailable" (socket inexistente o conexión rechazada) no es saturación,
+        // que da EAGAIN o plazos vencidos: el daemon ya no está
+        if (r.admitted() && (double)r.unavailable / r.admitted() > SATURATION_ERRORS) {
+            std::cerr << "ERROR: daemon stopped accepting connections at " << rate
+                      << " req/s (last sustained " << best << " req/s)\n";
+            return 1;
+        }
+        bool saturated = r.throughput < SATURATION_THROUGHPUT * rate ||
+                         r.error_rate() > SATURATION_ERRORS ||
+                         (deadline_ms > 0 && r.p99_us > deadline_ms * 1000.0);
+        if (saturated) {
+            std::cerr << "Saturated at " << rate << " req/s (sustained " << std::fixed
+                      << std::setprecision(1) << best << " req/s)\n";
+            return 0;
+        }
+        best = r.throughput;
+    }
+    std::cerr << "Not saturated after " << MAX_RAMP_STEPS << " steps (last " << best << " req/s)\n";
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * predictor_protocol.h
+ *
+ * Formato de los mensajes entre los clientes (colector, herramientas) y el
+ * daemon ml_predictor por el socket Unix. Una conexión por petición.
+ *
+ * v1 (legacy):  petición = 5 floats (20 bytes), respuesta = 1 int (clase).
+ * v2:           petición = PredictRequestHeader + num_features floats,
+ *               respuesta = PredictResponse.
+ *
+ * El daemon distingue ambas versiones por los 4 primeros bytes: el magic de
+ * v2 tiene el patrón de bits de un NaN, que nunca es una distancia media
+ * válida como primer float de una petición v1.
+ *
+ * Trazas (v2, opcional): con PREDICT_REQ_TRACE en los flags la petición
+ * termina con PredictTraceRequest y el daemon añade PredictTraceReply tras
+ * la respuesta, marcado con PREDICT_RESP_TRACE. Un daemon anterior ignora
+ * los bytes extra y responde sin ellos.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#define PREDICT_V2_MAGIC          0xFFC04B4Du   // NaN negativo con "KM" en los bytes bajos
+#define PREDICT_PROTOCOL_VERSION  2
+#define PREDICT_MAX_FEATURES      16
+#define PREDICT_V1_REQUEST_BYTES  (5 * sizeof(float))
+
+// Flujo de I/O del que salen las características (flags de la petición,
+// bits 0-1). El bundle declara el que consume su modelo con "stream = ...".
+#define PREDICT_STREAM_ALL        0u   // lecturas y escrituras juntas (v1 y bundles antiguos)
+#define PREDICT_STREAM_READ       1u
+#define PREDICT_STREAM_WRITE      2u
+#define PREDICT_STREAM_MASK       0x3u
+#define PREDICT_REQ_TRACE         0x4u   // sigue PredictTraceRequest a las características
+
+static const char* const PREDICT_STREAM_NAMES[3] = {"all", "read", "write"};
+
+// Flags de PredictResponse
+#define PREDICT_RESP_OOD     0x1   // entrada fuera de la distribución de entrenamiento
+#define PREDICT_RESP_DRIFT   0x2   // drift sostenido en las ventanas recientes del dispositivo
+#define PREDICT_RESP_STREAM_MISMATCH 0x4   // el modelo consume otro flujo: no se predijo
+#define PREDICT_RESP_TRACE   0x8   // sigue PredictTraceReply a la respuesta
+#define PREDICT_RESP_STREAM_SHIFT 8        // bits 8-9: flujo que consume el modelo
+
+static inline uint32_t predict_resp_stream(uint32_t flags) {
+    return (flags >> PREDICT_RESP_STREAM_SHIFT) & PREDICT_STREAM_MASK;
+}
+
+// La máscara de 2 bits admite 3, que no es un flujo: validar antes de indexar
+static inline bool predict_stream_valid(uint32_t stream) {
+    return stream <= PREDICT_STREAM_WRITE;
+}
+
+// "all" / "read" / "write" -> PREDICT_STREAM_*; -1 si no es válido
+static inline int parse_predict_stream(const std::string& name) {
+    for (int i = 0; i < 3; i++)
+        if (name == PREDICT_STREAM_NAMES[i]) return i;
+    return -1;
+}
+
+struct PredictRequestHeader {
+    uint32_t magic;          // PREDICT_V2_MAGIC
+    uint16_t version;        // PREDICT_PROTOCOL_VERSION
+    uint16_t num_features;   // floats que siguen a la cabecera
+    uint32_t device_id;      // dev_t del dispositivo (MKDEV del kernel), 0 = desconocido
+    uint32_t flags;          // PREDICT_STREAM_* en los bits 0-1, PREDICT_REQ_TRACE
+} __attribute__((packed));
+
+struct PredictResponse {
+    int32_t pred_class;      // clase predicha (>= 0)
+    uint32_t flags;          // PREDICT_RESP_*
+    float drift_score;       // PSI máximo entre características del dispositivo
+    uint32_t reserved;
+} __attribute__((packed));
+
+// Marcas en ns de CLOCK_MONOTONIC, el mismo reloj en todos los procesos del host
+static inline uint64_t predict_monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+struct PredictTraceRequest {
+    uint64_t trace_id;
+    uint64_t sent_ns;        // el cliente justo antes de conectar
+} __attribute__((packed));
+
+struct PredictTraceReply {
+    uint64_t trace_id;       // eco de la petición
+    uint64_t received_ns;    // el daemon tras leer la cabecera
+    uint64_t inferred_ns;    // el daemon tras la inferencia
+} __attribute__((packed));
@@ -0,0 +1,157 @@
+/*
+ * pressure_guard.h
+ *
+ * Presión de memoria e I/O por ventana (PSI, /proc/pressure/{io,memory} y,
+ * opcionalmente, io.pressure/memory.pressure de un cgroup v2) y el tope de
+ * read_ahead_kb que se deriva de ella.
+ *
+ * De cada archivo se usa el contador total= (µs acumulados con tareas
+ * bloqueadas): su incremento dividido por la duración de la ventana da la
+ * fracción de tiempo con stall exactamente en esa ventana, sin el retraso
+ * de avg10. Los eventos de reclaim (tracepoints mm_vmscan_*) los cuenta el
+ * programa BPF del colector y se añaden al resultado.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Umbrales (fracción de la ventana con stall)
+#define PRESSURE_MEM_FULL_SEVERE  0.05   // todas las tareas bloqueadas en memoria
+#define PRESSURE_MEM_SOME_HIGH    0.10
+#define PRESSURE_IO_FULL_HIGH     0.20
+#define PRESSURE_CAP_SEVERE_KB    16
+#define PRESSURE_CAP_HIGH_KB      64
+
+struct PsiTotals {
+    bool valid;
+    uint64_t some_us;
+    uint64_t full_us;
+};
+
+struct PressureWindow {
+    bool have_system;
+    bool have_cgroup;
+    double io_some, io_full, mem_some, mem_full;            // sistema
+    double cg_io_some, cg_io_full, cg_mem_some, cg_mem_full; // cgroup (si se configuró)
+    uint64_t direct_reclaims;     // mm_vmscan_direct_reclaim_begin
+    uint64_t kswapd_wakes;        // mm_vmscan_kswapd_wake
+    uint64_t pages_reclaimed;     // nr_reclaimed de mm_vmscan_lru_shrink_inactive
+};
+
+/**
+ * Lee las líneas "some ... total=N" y "full ... total=N" de un archivo PSI.
+ * En el archivo de CPU del sistema no hay línea full: queda a 0.
+ */
+static inline PsiTotals read_psi_totals(const std::string& path) {
+    PsiTotals t = {false, 0, 0};
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t pos = line.find("total=");
+        if (pos == std::string::npos) continue;
+        uint64_t total = std::stoull(line.substr(pos + 6));
+        if (line.compare(0, 4, "some") == 0) {
+            t.some_us = total;
+            t.valid = true;
+        } else if (line.compare(0, 4, "full") == 0) {
+            t.full_us = total;
+        }
+    }
+    return t;
+}
+
+class PressureMonitor {
+private:
+    std::string cgroup_dir;
+    PsiTotals prev[4];   // io, memory, cg io, cg memory
+    std::chrono::steady_clock::time_point prev_time;
+
+    static std::string path_of(int i, const std::string& cg) {
+        switch (i) {
+        case 0: return "/proc/pressure/io";
+        case 1: return "/proc/pressure/memory";
+        case 2: return cg + "/io.pressure";
+        default: return cg + "/memory.pressure";
+        }
+    }
+
+    static double frac(uint64_t now, uint64_t before, double window_us) {
+        if (window_us <= 0.0 || now < before) return 0.0;
+        double f = (double)(now - before) / window_us;
+        return f > 1.0 ? 1.0 : f;
+    }
+
+public:
+    PressureMonitor() : prev() {}
+
+    // Directorio del cgroup v2 a vigilar además del sistema (vacío = ninguno)
+    void set_cgroup(const std::string& dir) { cgroup_dir = dir; }
+
+    // true si el kernel expone PSI (CONFIG_PSI y psi=1)
+    bool available() const { return read_psi_totals(path_of(0, "")).valid; }
+
+    /**
+     * Fracción de stall de cada recurso desde la llamada anterior. La
+     * primera llamada solo fija la referencia y devuelve ceros.
+     */
+    PressureWindow sample() {
+        auto now_time = std::chrono::steady_clock::now();
+        double window_us = std::chrono::duration<double, std::micro>(now_time - prev_time).count();
+        prev_time = now_time;
+
+        PressureWindow w = {};
+        double* out[4][2] = {
+            {&w.io_some, &w.io_full}, {&w.mem_some, &w.mem_full},
+            {&w.cg_io_some, &w.cg_io_full}, {&w.cg_mem_some, &w.cg_mem_full}
+        };
+        int n = cgroup_dir.empty() ? 2 : 4;
+        for (int i = 0; i < n; i++) {
+            PsiTotals now = read_psi_totals(path_of(i, cgroup_dir));
+            if (now.valid && prev[i].valid) {
+                *out[i][0] = frac(now.some_us, prev[i].some_us, window_us);
+                *out[i][1] = frac(now.full_us, prev[i].full_us, window_us);
+                if (i < 2) w.have_system = true;
+                else w.have_cgroup = true;
+            }
+            prev[i] = now;
+        }
+        return w;
+    }
+
+    /**
+     * Tope de read_ahead_kb para la ventana (0 = sin tope). Con reclaim
+     * directo o stall total de memoria, el prefetch expulsa páginas que se
+     * van a necesitar: se baja al valor de acceso aleatorio.
+     */
+    static int readahead_cap(const PressureWindow& w, std::string* reason) {
+        double mem_full = w.have_cgroup ? std::max(w.mem_full, w.cg_mem_full) : w.mem_full;
+        double mem_some = w.have_cgroup ? std::max(w.mem_some, w.cg_mem_some) : w.mem_some;
+        double io_full = w.have_cgroup ? std::max(w.io_full, w.cg_io_full) : w.io_full;
+
+        std::ostringstream oss;
+        if (w.direct_reclaims > 0 || mem_full > PRESSURE_MEM_FULL_SEVERE) {
+            oss << "memory pressure (full=" << mem_full << ", direct_reclaims="
+                << w.direct_reclaims << ")";
+            if (reason) *reason = oss.str();
+            return PRESSURE_CAP_SEVERE_KB;
+        }
+        if (mem_some > PRESSURE_MEM_SOME_HIGH) {
+            oss << "memory pressure (some=" << mem_some << ")";
+            if (reason) *reason = oss.str();
+            return PRESSURE_CAP_HIGH_KB;
+        }
+        if (io_full > PRESSURE_IO_FULL_HIGH) {
+            oss << "io pressure (full=" << io_full << ")";
+            if (reason) *reason = oss.str();
+            return PRESSURE_CAP_HIGH_KB;
+        }
+        return 0;
+    }
+};
@@ -0,0 +1,292 @@
+/*
+ * timer_wheel.h
+ *
+ * Planificación del cierre de ventanas de muchos flujos (dispositivo,
+ * cgroup, archivo) con un único timerfd.
+ *
+ * TimerWheel es una rueda jerárquica de WHEEL_LEVELS niveles de
+ * WHEEL_SLOTS ranuras (como los timers clásicos del kernel): el nivel L
+ * cubre 64^(L+1) ticks, insertar y cancelar son O(1) sobre listas
+ * intrusivas y, al pasar por la ranura 0 de un nivel, los timers de la
+ * ranura siguiente del nivel superior bajan en cascada. Un mapa de bits por
+ * nivel da la siguiente ranura ocupada sin recorrerlas todas.
+ *
+ * WindowScheduler arma el timerfd (CLOCK_MONOTONIC, absoluto) al siguiente
+ * vencimiento de la rueda: la rueda solo avanza cuando el timerfd dispara,
+ * y los flujos que vencen en el mismo tick se entregan en un solo lote. El
+ * coste por vuelta del bucle de eventos es una lectura del reloj y otra no
+ * bloqueante del timerfd, independiente del número de flujos.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1u << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4            // 2^24 ticks: ~4.6 h con ticks de 1 ms
+#define WHEEL_NONE 0xFFFFFFFFu
+#define WHEEL_TICK_NS 1000000ULL  // 1 ms
+
+class TimerWheel {
+private:
+    struct Node {
+        uint64_t expires;      // tick de vencimiento
+        uint32_t prev;
+        uint32_t next;
+        uint16_t slot;         // nivel * WHEEL_SLOTS + ranura
+        bool armed;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t heads[WHEEL_LEVELS * WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_LEVELS];   // bit por ranura con timers
+    uint64_t current;                  // último tick procesado
+    size_t armed_count;
+    std::vector<uint32_t> batch;
+
+    // En cascada el tick actual aún no se ha vencido; fuera de ella, sí
+    void link(uint32_t h, bool cascading = false) {
+        Node& n = nodes[h];
+        uint64_t e = n.expires > current ? n.expires : current + (cascading ? 0 : 1);
+        uint64_t delta = e - current;
+        int level = 0;
+        while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) level++;
+        // Más allá del último nivel: se aparca en el más lejano y se reinserta al bajar
+        uint64_t span = 1ULL << (WHEEL_BITS * WHEEL_LEVELS);
+        if (delta >= span) e = current + span - 1;
+        unsigned idx = (unsigned)(e >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        uint16_t s = (uint16_t)(level * WHEEL_SLOTS + idx);
+        n.slot = s;
+        n.prev = WHEEL_NONE;
+        n.next = heads[s];
+        if (heads[s] != WHEEL_NONE) nodes[heads[s]].prev = h;
+        heads[s] = h;
+        occupied[level] |= 1ULL << idx;
+    }
+
+    void unlink(uint32_t h) {
+        Node& n = nodes[h];
+        if (n.prev != WHEEL_NONE) nodes[n.prev].next = n.next;
+        else heads[n.slot] = n.next;
+        if (n.next != WHEEL_NONE) nodes[n.next].prev = n.prev;
+        if (heads[n.slot] == WHEEL_NONE)
+            occupied[n.slot / WHEEL_SLOTS] &= ~(1ULL << (n.slot % WHEEL_SLOTS));
+    }
+
+    // Saca la lista de una ranura entera; devuelve su cabeza
+    uint32_t take(int level, unsigned idx) {
+        uint16_t s = (uint16_t)(level * WHEEL_SLOTS + idx);
+        uint32_t h = heads[s];
+        heads[s] = WHEEL_NONE;
+        occupied[level] &= ~(1ULL << idx);
+        return h;
+    }
+
+    void cascade(int level) {
+        unsigned idx = (unsigned)(current >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        for (uint32_t h = take(level, idx); h != WHEEL_NONE;) {
+            uint32_t next = nodes[h].next;
+            link(h, true);
+            h = next;
+        }
+    }
+
+    void tick() {
+        current++;
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if ((current & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0) break;
+            cascade(level);
+        }
+        unsigned idx = (unsigned)current & WHEEL_MASK;
+        if (!(occupied[0] & (1ULL << idx))) return;
+        for (uint32_t h = take(0, idx); h != WHEEL_NONE;) {
+            uint32_t next = nodes[h].next;
+            if (nodes[h].expires <= current) {
+                nodes[h].armed = false;
+                armed_count--;
+                batch.push_back(h);
+            } else {
+                link(h);           // aparcado más allá del último nivel
+            }
+            h = next;
+        }
+    }
+
+public:
+    explicit TimerWheel(uint64_t start_tick = 0) : current(start_tick), armed_count(0) {
+        for (auto& h : heads) h = WHEEL_NONE;
+        for (auto& o : occupied) o = 0;
+    }
+
+    // Nuevo timer (desarmado); el handle es estable mientras viva la rueda
+    uint32_t create() {
+        nodes.push_back(Node{0, WHEEL_NONE, WHEEL_NONE, 0, false});
+        return (uint32_t)(nodes.size() - 1);
+    }
+
+    void schedule(uint32_t h, uint64_t expires_tick) {
+        if (nodes[h].armed) unlink(h);
+        else armed_count++;
+        nodes[h].expires = expires_tick;
+        nodes[h].armed = true;
+        link(h);
+    }
+
+    void cancel(uint32_t h) {
+        if (!nodes[h].armed) return;
+        unlink(h);
+        nodes[h].armed = false;
+        armed_count--;
+    }
+
+    bool armed(uint32_t h) const { return nodes[h].armed; }
+    uint64_t expires(uint32_t h) const { return nodes[h].expires; }
+    uint64_t now() const { return current; }
+    size_t size() const { return armed_count; }
+
+    /**
+     * Avanza hasta target (tick absoluto) y devuelve los timers vencidos en
+     * un lote; el lote vale hasta la siguiente llamada.
+     */
+    const std::vector<uint32_t>& advance_to(uint64_t target) {
+        batch.clear();
+        while (current < target) {
+            // Sin timers no hay nada que bajar ni vencer: saltar directamente
+            if (armed_count == 0) {
+                current = target;
+                break;
+            }
+            // Nivel 0 vacío: saltar hasta el tick anterior a la siguiente cascada
+            if (!occupied[0]) {
+                uint64_t edge = (current | WHEEL_MASK);
+                current = edge < target ? edge : target;
+                if (current == target) break;
+            }
+            tick();
+        }
+        return batch;
+    }
+
+    /**
+     * Ticks hasta el siguiente punto en el que la rueda tiene trabajo: el
+     * vencimiento exacto si está en el nivel 0, o la siguiente cascada de un
+     * nivel superior ocupado. UINT64_MAX sin timers.
+     */
+    uint64_t ticks_to_next() const {
+        if (armed_count == 0) return UINT64_MAX;
+        uint64_t best = UINT64_MAX;
+        for (int level = 0; level < WHEEL_LEVELS; level++) {
+            if (!occupied[level]) continue;
+            int shift = WHEEL_BITS * level;
+            unsigned cur = (unsigned)(current >> shift) & WHEEL_MASK;
+            // Ranuras ocupadas desde la siguiente a la actual, en orden circular
+            uint64_t rot = (occupied[level] >> ((cur + 1) & WHEEL_MASK)) |
+                           (occupied[level] << ((WHEEL_SLOTS - cur - 1) & WHEEL_MASK));
+            if (cur + 1 == WHEEL_SLOTS) rot = occupied[level];
+            unsigned dist = (unsigned)__builtin_ctzll(rot) + 1;
+            uint64_t block = ((current >> shift) + dist) << shift;
+            uint64_t t = block - current;
+            if (t < best) best = t;
+        }
+        return best;
+    }
+};
+
+/**
+ * TimerWheel movida por un timerfd armado al siguiente vencimiento. Uso:
+ *
+ *   h = sched.add_stream();
+ *   sched.schedule(h, deadline_ns);
+ *   while (...) {
+ *       poll_eventos(sched.timeout_ms(50));
+ *       for (uint32_t s : sched.expired()) cerrar_ventana(s);
+ *   }
+ */
+class WindowScheduler {
+private:
+    TimerWheel wheel;
+    int tfd;
+    uint64_t armed_tick;       // tick al que está armado el timerfd (0 = desarmado)
+
+    static uint64_t monotonic_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    void rearm() {
+        uint64_t next = wheel.ticks_to_next();
+        uint64_t tick = next == UINT64_MAX ? 0 : wheel.now() + next;
+        if (tick == armed_tick) return;
+        struct itimerspec its = {};
+        if (tick) {
+            uint64_t ns = tick * WHEEL_TICK_NS;
+            its.it_value.tv_sec = (time_t)(ns / 1000000000ULL);
+            its.it_value.tv_nsec = (long)(ns % 1000000000ULL);
+        }
+        timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr);
+        armed_tick = tick;
+    }
+
+public:
+    WindowScheduler() : wheel(monotonic_ns() / WHEEL_TICK_NS), tfd(-1), armed_tick(0) {}
+
+    ~WindowScheduler() {
+        if (tfd >= 0) close(tfd);
+    }
+
+    bool open() {
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        return tfd >= 0;
+    }
+
+    int fd() const { return tfd; }
+    uint32_t add_stream() { return wheel.create(); }
+    size_t pending() const { return wheel.size(); }
+
+    // Vencimiento absoluto en ns de CLOCK_MONOTONIC, redondeado al tick siguiente
+    void schedule(uint32_t stream, uint64_t deadline_ns) {
+        // Rueda vacía: ponerla en hora en lugar de recorrer luego todo el hueco
+        if (wheel.size() == 0) wheel.advance_to(monotonic_ns() / WHEEL_TICK_NS);
+        wheel.schedule(stream, (deadline_ns + WHEEL_TICK_NS - 1) / WHEEL_TICK_NS);
+        rearm();
+    }
+
+    void cancel(uint32_t stream) {
+        wheel.cancel(stream);
+        rearm();
+    }
+
+    uint64_t deadline_ns(uint32_t stream) const { return wheel.expires(stream) * WHEEL_TICK_NS; }
+
+    // Espera máxima (ms, redondeada hacia arriba) hasta que dispare el timerfd, acotada a cap
+    int timeout_ms(int cap) const {
+        if (!armed_tick) return cap;
+        uint64_t at = armed_tick * WHEEL_TICK_NS;
+        uint64_t now = monotonic_ns();
+        if (at <= now) return 0;
+        uint64_t ms = (at - now + 999999ULL) / 1000000ULL;
+        return ms < (uint64_t)cap ? (int)ms : cap;
+    }
+
+    /**
+     * Flujos vencidos desde la última llamada (lote vacío si el timerfd no
+     * ha disparado). Solo lee el reloj cuando el timerfd disparó.
+     */
+    const std::vector<uint32_t>& expired() {
+        static const std::vector<uint32_t> none;
+        uint64_t fired;
+        if (read(tfd, &fired, sizeof(fired)) != (ssize_t)sizeof(fired)) return none;
+        armed_tick = 0;
+        const std::vector<uint32_t>& batch = wheel.advance_to(monotonic_ns() / WHEEL_TICK_NS);
+        rearm();
+        return batch;
+    }
+};
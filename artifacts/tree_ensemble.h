@@ -0,0 +1,161 @@
+/*
+ * tree_ensemble.h
+ *
+ * Backend de inferencia para ensembles de árboles (gradient boosting o
+ * random forest) exportados por red_neuronal/train_trees.py.
+ *
+ * Cada árbol se guarda como árbol binario completo de profundidad fija D en
+ * orden de heap (hijos de i en 2i+1 y 2i+2), con los nodos internos y las
+ * hojas en arrays planos contiguos. Las ramas más cortas se rellenan con
+ * nodos de umbral +inf que siempre van a la izquierda, así que recorrer un
+ * árbol son exactamente D pasos sin saltos condicionales:
+ *
+ *     i = 2*i + 1 + (x[feature[i]] > threshold[i])
+ *
+ * Los árboles se evalúan en bloques de TREE_LANES independientes para que
+ * el compilador pueda intercalarlos (ILP) o vectorizarlos con gathers. El
+ * mismo layout se puede recorrer con un bucle acotado en BPF o en el kernel.
+ *
+ * Formato de archivo (texto):
+ *   TREE_ENSEMBLE 1
+ *   num_features 5
+ *   num_classes 3
+ *   num_trees T
+ *   depth D
+ *   base b0 b1 b2
+ *   tree
+ *   <2^D - 1 líneas "feature threshold">
+ *   <2^D líneas "v0 v1 v2">
+ *   ... (T bloques "tree")
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define TREE_ENSEMBLE_MAGIC "TREE_ENSEMBLE"
+#define TREE_LANES 8
+
+struct TreeNode {
+    float threshold;
+    int32_t feature;
+};
+
+class TreeEnsemble {
+private:
+    int num_features;
+    int num_classes;
+    int num_trees;          // árboles reales
+    int padded_trees;       // múltiplo de TREE_LANES (los de relleno valen 0)
+    int depth;
+    int internal_per_tree;  // 2^D - 1
+    int leaves_per_tree;    // 2^D
+
+    std::vector<TreeNode> nodes;   // padded_trees * internal_per_tree
+    std::vector<float> leaves;     // padded_trees * leaves_per_tree * num_classes
+    std::vector<float> base;       // num_classes
+
+    static void expect(std::istream& in, const std::string& word) {
+        std::string w;
+        if (!(in >> w) || w != word)
+            throw std::runtime_error("tree ensemble: expected '" + word + "', got '" + w + "'");
+    }
+
+public:
+    TreeEnsemble() : num_features(0), num_classes(0), num_trees(0), padded_trees(0),
+                     depth(0), internal_per_tree(0), leaves_per_tree(0) {}
+
+    void load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) throw std::runtime_error("tree ensemble: cannot open " + path);
+
+        int version = 0;
+        expect(in, TREE_ENSEMBLE_MAGIC);
+        in >> version;
+        if (version != 1) throw std::runtime_error("tree ensemble: unsupported version");
+        expect(in, "num_features"); in >> num_features;
+        expect(in, "num_classes"); in >> num_classes;
+        expect(in, "num_trees"); in >> num_trees;
+        expect(in, "depth"); in >> depth;
+        if (!in || num_features <= 0 || num_classes <= 0 || num_classes > 16 || num_trees <= 0 ||
+            depth <= 0 || depth > 16)
+            throw std::runtime_error("tree ensemble: invalid header in " + path);
+
+        base.assign(num_classes, 0.0f);
+        expect(in, "base");
+        for (int c = 0; c < num_classes; c++) in >> base[c];
+
+        internal_per_tree = (1 << depth) - 1;
+        leaves_per_tree = 1 << depth;
+        padded_trees = (num_trees + TREE_LANES - 1) / TREE_LANES * TREE_LANES;
+
+        // Árboles de relleno: umbral +inf y hojas a cero
+        nodes.assign((size_t)padded_trees * internal_per_tree,
+                     TreeNode{std::numeric_limits<float>::infinity(), 0});
+        leaves.assign((size_t)padded_trees * leaves_per_tree * num_classes, 0.0f);
+
+        for (int t = 0; t < num_trees; t++) {
+            expect(in, "tree");
+            TreeNode* tn = &nodes[(size_t)t * internal_per_tree];
+            for (int i = 0; i < internal_per_tree; i++) {
+                std::string thr;
+                in >> tn[i].feature >> thr;
+                tn[i].threshold = (thr == "inf") ? std::numeric_limits<float>::infinity()
+                                                 : std::stof(thr);
+                if (tn[i].feature < 0 || tn[i].feature >= num_features)
+                    throw std::runtime_error("tree ensemble: feature index out of range");
+            }
+            float* lv = &leaves[(size_t)t * leaves_per_tree * num_classes];
+            for (int i = 0; i < leaves_per_tree * num_classes; i++) in >> lv[i];
+        }
+        if (!in) throw std::runtime_error("tree ensemble: truncated file " + path);
+    }
+
+    /**
+     * Suma las hojas de todos los árboles para un vector ya normalizado.
+     *
+     * @param x Características normalizadas (num_features floats)
+     * @param scores Salida: num_classes puntuaciones (base + suma de hojas)
+     */
+    void scores(const float* x, float* scores) const {
+        for (int c = 0; c < num_classes; c++) scores[c] = base[c];
+
+        for (int t0 = 0; t0 < padded_trees; t0 += TREE_LANES) {
+            const TreeNode* block = &nodes[(size_t)t0 * internal_per_tree];
+            uint32_t idx[TREE_LANES] = {};
+
+            for (int d = 0; d < depth; d++) {
+                for (int l = 0; l < TREE_LANES; l++) {
+                    const TreeNode& n = block[l * internal_per_tree + idx[l]];
+                    idx[l] = 2 * idx[l] + 1 + (uint32_t)(x[n.feature] > n.threshold);
+                }
+            }
+
+            for (int l = 0; l < TREE_LANES; l++) {
+                uint32_t leaf = idx[l] - (uint32_t)internal_per_tree;
+                const float* lv = &leaves[((size_t)(t0 + l) * leaves_per_tree + leaf) * num_classes];
+                for (int c = 0; c < num_classes; c++) scores[c] += lv[c];
+            }
+        }
+    }
+
+    int predict(const float* x) const {
+        float s[16];
+        scores(x, s);
+        int best = 0;
+        for (int c = 1; c < num_classes; c++)
+            if (s[c] > s[best]) best = c;
+        return best;
+    }
+
+    int get_num_features() const { return num_features; }
+    int get_num_classes() const { return num_classes; }
+    int get_num_trees() const { return num_trees; }
+    int get_depth() const { return depth; }
+};
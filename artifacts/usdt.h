@@ -0,0 +1,108 @@
+/*
+ * usdt.h
+ *
+ * Puntos de traza estáticos (USDT) del colector y del daemon.
+ *
+ * Con <sys/sdt.h> (paquete systemtap-sdt-dev / systemtap-sdt-devel) cada
+ * USDT_PROBEn deja un nop en el código y una nota .note.stapsdt en el
+ * binario, con un semáforo por sonda (sección .probes) que el trazador
+ * incrementa al activarla:
+ *
+ *   bpftrace -l 'usdt:./ebpf_block_trace:*'
+ *   bpftrace -e 'usdt:./ebpf_block_trace:readahead:ipc_recv { @[arg2] = hist(arg3); }'
+ *   bpftrace -e 'usdt:./ml_predictor:ml_predictor:inference_end { @ = hist(arg2); }'
+ *
+ * Los argumentos (y la lectura del reloj de las duraciones, USDT_START)
+ * solo se evalúan con el semáforo activo: desactivadas, cada sonda cuesta
+ * una lectura de memoria. Las herramientas que no gestionan semáforos SDT
+ * no ven las sondas. Sin la cabecera (o con -DNO_USDT) las macros no
+ * generan nada.
+ *
+ * Proveedores y sondas:
+ *
+ *   readahead (ebpf_block_trace)
+ *     window_open(dev, window)
+ *     window_close(dev, window, events, reqs)
+ *     features(dev, window, ns)
+ *     ipc_send(dev, window)
+ *     ipc_recv(dev, window, pred, ns)          pred < 0: PREDICT_ERR_*
+ *     sysfs_write(dev, window, ra_kb, ns, ok)
+ *
+ *   ml_predictor (ml_predictor)
+ *     request_recv(dev, stream, version)       version 1 o 2
+ *     inference_start(dev)
+ *     inference_end(dev, pred, ns)
+ *     response_send(dev, pred)
+ *
+ * dev es el dev_t del dispositivo (MKDEV del kernel) y window el número de
+ * ventana del colector.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if !defined(NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define USDT_ENABLED 1
+#endif
+#endif
+
+#ifdef USDT_ENABLED
+// <proveedor>_<sonda>_semaphore, el nombre que la nota de sys/sdt.h referencia
+#define USDT_SEMAPHORE(prov, name) \
+    __extension__ volatile unsigned short prov##_##name##_semaphore \
+        __attribute__((weak, used, section(".probes"))) = 0
+
+USDT_SEMAPHORE(readahead, window_open);
+USDT_SEMAPHORE(readahead, window_close);
+USDT_SEMAPHORE(readahead, features);
+USDT_SEMAPHORE(readahead, ipc_send);
+USDT_SEMAPHORE(readahead, ipc_recv);
+USDT_SEMAPHORE(readahead, sysfs_write);
+USDT_SEMAPHORE(ml_predictor, request_recv);
+USDT_SEMAPHORE(ml_predictor, inference_start);
+USDT_SEMAPHORE(ml_predictor, inference_end);
+USDT_SEMAPHORE(ml_predictor, response_send);
+
+#define USDT_ACTIVE(prov, name) __builtin_expect(prov##_##name##_semaphore != 0, 0)
+#define USDT_PROBE1(prov, name, a) \
+    do { if (USDT_ACTIVE(prov, name)) DTRACE_PROBE1(prov, name, a); } while (0)
+#define USDT_PROBE2(prov, name, a, b) \
+    do { if (USDT_ACTIVE(prov, name)) DTRACE_PROBE2(prov, name, a, b); } while (0)
+#define USDT_PROBE3(prov, name, a, b, c) \
+    do { if (USDT_ACTIVE(prov, name)) DTRACE_PROBE3(prov, name, a, b, c); } while (0)
+#define USDT_PROBE4(prov, name, a, b, c, d) \
+    do { if (USDT_ACTIVE(prov, name)) DTRACE_PROBE4(prov, name, a, b, c, d); } while (0)
+#define USDT_PROBE5(prov, name, a, b, c, d, e) \
+    do { if (USDT_ACTIVE(prov, name)) DTRACE_PROBE5(prov, name, a, b, c, d, e); } while (0)
+#else
+#define USDT_ENABLED 0
+#define USDT_ACTIVE(prov, name) 0
+// sizeof no evalúa los argumentos pero evita avisos de variables sin usar
+#define USDT_PROBE1(prov, name, a) do { (void)sizeof(a); } while (0)
+#define USDT_PROBE2(prov, name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define USDT_PROBE3(prov, name, a, b, c) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#define USDT_PROBE4(prov, name, a, b, c, d) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); } while (0)
+#define USDT_PROBE5(prov, name, a, b, c, d, e) \
+    do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); (void)sizeof(d); (void)sizeof(e); } while (0)
+#endif
+
+// Reloj monotónico en ns para las duraciones de las sondas
+static inline uint64_t usdt_now_ns() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Inicio de una duración: solo lee el reloj si la sonda que la emite está activa
+#define USDT_START(prov, name) (USDT_ACTIVE(prov, name) ? usdt_now_ns() : 0)
+
+// ns desde USDT_START; 0 si la sonda se activó entre medias
+static inline uint64_t usdt_since(uint64_t t0) {
+    return t0 ? usdt_now_ns() - t0 : 0;
+}
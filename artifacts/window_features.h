@@ -0,0 +1,343 @@
+/*
+ * window_features.h
+ *
+ * Agregados de ventana y extracción de características multi-resolución.
+ *
+ * Las 5 características del modelo (distancia promedio, jump ratio, tamaño
+ * promedio de I/O, ratio secuencial e IOPS) se pueden obtener combinando
+ * agregados de sub-ventanas alineadas: basta con guardar por sub-ventana el
+ * primer y último sector además de las sumas. Así una sola pasada sobre los
+ * eventos produce las características para varios tamaños de ventana.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <functional>
+#include <numeric>
+
+// ============================================================================
+// EVENTOS
+// ============================================================================
+
+// Evento de bloque tal como lo entrega el programa eBPF (ver info_t)
+struct BlockEvent {
+    uint64_t sector;
+    uint32_t bytes;
+    uint64_t ts;
+    uint32_t rw;
+} __attribute__((packed));
+
+// BlockEvent::rw: operación en los bits 0-2 y flags de la petición en los
+// bits 8-12, decodificados del campo rwbs del tracepoint (blk_fill_rwbs).
+// Las grabaciones antiguas solo tienen 0 (lectura) o 1 (escritura).
+#define BLOCK_OP_MASK      0x7u
+#define BLOCK_OP_READ      0u            // 'R'
+#define BLOCK_OP_WRITE     1u            // 'W'
+#define BLOCK_OP_DISCARD   2u            // 'D'
+#define BLOCK_OP_SECURE_ERASE 3u         // 'DE'
+#define BLOCK_OP_FLUSH     4u            // 'F' como operación (sin datos)
+#define BLOCK_OP_OTHER     5u            // 'N': write zeroes, zone ops...
+#define BLOCK_OP_COUNT     6
+
+#define BLOCK_EV_WRITE     0x1u          // == BLOCK_OP_WRITE
+#define BLOCK_FL_PREFLUSH  0x100u        // 'F' delante de la operación
+#define BLOCK_FL_FUA       0x200u        // 'F' detrás de la operación
+#define BLOCK_FL_RAHEAD    0x400u        // 'A': readahead del kernel
+#define BLOCK_FL_SYNC      0x800u        // 'S'
+#define BLOCK_FL_META      0x1000u       // 'M'
+#define BLOCK_EV_SAMPLED   0x40000000u   // muestra 1/N de un dispositivo en modo sampled
+#define BLOCK_EV_COMPLETE  0x80000000u   // emitido por block_rq_complete (si no, block_rq_issue)
+
+static const char* const BLOCK_OP_NAMES[BLOCK_OP_COUNT] = {
+    "read", "write", "discard", "secure_erase", "flush", "other"
+};
+
+static inline uint32_t block_ev_op(uint32_t rw) { return rw & BLOCK_OP_MASK; }
+
+// Solo lecturas y escrituras describen el patrón de acceso: discards y
+// flushes no mueven datos y sus "bytes" falsearían el ancho de banda.
+static inline bool block_ev_is_data(uint32_t rw) {
+    uint32_t op = block_ev_op(rw);
+    return op == BLOCK_OP_READ || op == BLOCK_OP_WRITE;
+}
+
+/**
+ * Peticiones por operación y por flag en una ventana. Se cuentan solo los
+ * eventos de block_rq_issue para no contar dos veces cada I/O.
+ */
+struct OpCounters {
+    uint64_t reqs[BLOCK_OP_COUNT];
+    uint64_t bytes[BLOCK_OP_COUNT];
+    uint64_t rahead, sync, meta, fua, preflush;
+
+    OpCounters() { reset(); }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    void add(uint32_t rw, uint32_t nbytes) {
+        uint32_t op = block_ev_op(rw);
+        if (op >= BLOCK_OP_COUNT) op = BLOCK_OP_OTHER;
+        reqs[op]++;
+        bytes[op] += nbytes;
+        if (rw & BLOCK_FL_RAHEAD) rahead++;
+        if (rw & BLOCK_FL_SYNC) sync++;
+        if (rw & BLOCK_FL_META) meta++;
+        if (rw & BLOCK_FL_FUA) fua++;
+        if (rw & BLOCK_FL_PREFLUSH) preflush++;
+    }
+
+    void merge(const OpCounters& o) {
+        for (int i = 0; i < BLOCK_OP_COUNT; i++) {
+            reqs[i] += o.reqs[i];
+            bytes[i] += o.bytes[i];
+        }
+        rahead += o.rahead;
+        sync += o.sync;
+        meta += o.meta;
+        fua += o.fua;
+        preflush += o.preflush;
+    }
+
+    // "read=120 write=3 discard=1 ... rahead=40" (solo los no nulos)
+    std::string summary() const {
+        std::ostringstream oss;
+        for (int i = 0; i < BLOCK_OP_COUNT; i++)
+            if (reqs[i]) oss << BLOCK_OP_NAMES[i] << "=" << reqs[i] << " ";
+        oss << "rahead=" << rahead << " sync=" << sync << " meta=" << meta;
+        return oss.str();
+    }
+};
+
+// Cabecera de los archivos de eventos grabados con --record
+#define EVENT_FILE_MAGIC "KMLEVT1"
+
+static inline bool write_event_file_header(FILE* fp) {
+    char magic[8] = {};
+    memcpy(magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC) - 1);
+    uint32_t rec_size = sizeof(BlockEvent);
+    return fwrite(magic, sizeof(magic), 1, fp) == 1 &&
+           fwrite(&rec_size, sizeof(rec_size), 1, fp) == 1;
+}
+
+static inline bool read_event_file_header(FILE* fp) {
+    char magic[8] = {};
+    uint32_t rec_size = 0;
+    if (fread(magic, sizeof(magic), 1, fp) != 1) return false;
+    if (fread(&rec_size, sizeof(rec_size), 1, fp) != 1) return false;
+    return memcmp(magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC) - 1) == 0 &&
+           rec_size == sizeof(BlockEvent);
+}
+
+// ============================================================================
+// CARACTERÍSTICAS
+// ============================================================================
+
+#define NUM_FEATURES 5
+
+static const char* const FEATURE_NAMES[NUM_FEATURES] = {
+    "avg_distance_bytes",
+    "jump_ratio",
+    "avg_io_bytes",
+    "seq_ratio",
+    "iops"
+};
+
+// ============================================================================
+// AGREGADO DE VENTANA
+// ============================================================================
+
+/**
+ * Estadísticas de una ventana (o sub-ventana) en memoria constante.
+ *
+ * merge() concatena dos ventanas contiguas en el tiempo: la distancia entre
+ * el último sector de la primera y el primer sector de la segunda se suma
+ * como un par consecutivo más, igual que si se hubiera visto en una sola
+ * ventana.
+ */
+struct WindowAggregate {
+    uint64_t reqs;
+    uint64_t bytes_acc;
+    uint64_t jumps;
+    uint64_t dist_sum;      // suma de |s[i] - s[i-1]| en sectores
+    uint64_t dist_cnt;      // pares consecutivos
+    uint64_t first_sector;
+    uint64_t last_sector;
+
+    WindowAggregate() { reset(); }
+
+    void reset() {
+        reqs = 0;
+        bytes_acc = 0;
+        jumps = 0;
+        dist_sum = 0;
+        dist_cnt = 0;
+        first_sector = 0;
+        last_sector = 0;
+    }
+
+    // distance = false omite la suma de distancias (plan sin avg_distance_bytes, feature_plan.h)
+    void add(uint64_t sector, uint32_t bytes, uint64_t jump_threshold_bytes, bool distance = true) {
+        if (reqs == 0) {
+            first_sector = sector;
+        } else {
+            uint64_t d = sector > last_sector ? sector - last_sector : last_sector - sector;
+            if (distance) {
+                dist_sum += d;
+                dist_cnt++;
+            }
+            if (d * 512 > jump_threshold_bytes) jumps++;
+        }
+        last_sector = sector;
+        bytes_acc += bytes;
+        reqs++;
+    }
+
+    void merge(const WindowAggregate& next, uint64_t jump_threshold_bytes) {
+        if (next.reqs == 0) return;
+        if (reqs == 0) {
+            *this = next;
+            return;
+        }
+        uint64_t d = next.first_sector > last_sector ? next.first_sector - last_sector
+                                                     : last_sector - next.first_sector;
+        dist_sum += next.dist_sum + d;
+        dist_cnt += next.dist_cnt + 1;
+        jumps += next.jumps + ((d * 512 > jump_threshold_bytes) ? 1 : 0);
+        reqs += next.reqs;
+        bytes_acc += next.bytes_acc;
+        last_sector = next.last_sector;
+    }
+
+    /**
+     * Calcula las 5 características del modelo.
+     *
+     * @param window_s Duración de la ventana en segundos
+     * @param f Array de NUM_FEATURES floats de salida
+     */
+    void features(double window_s, float* f) const {
+        if (reqs == 0 || window_s <= 0.0) {
+            for (int i = 0; i < NUM_FEATURES; i++) f[i] = 0.0f;
+            return;
+        }
+
+        double avg_sectors = dist_cnt ? (double)dist_sum / (double)dist_cnt : 0.0;
+        float avg_bytes = (float)(avg_sectors * 512.0);
+        float jump_ratio = (float)jumps / (float)reqs;
+        float bw_kbps = ((float)bytes_acc / 1024.0f) / (float)window_s;
+        float iops = (float)reqs / (float)window_s;
+        float avg_io_bytes = (iops > 0.001f) ? ((bw_kbps * 1024.0f) / iops) : 0.0f;
+        float seq_ratio = 1.0f - jump_ratio;
+        if (seq_ratio < 0.0f) seq_ratio = 0.0f;
+        if (seq_ratio > 1.0f) seq_ratio = 1.0f;
+
+        f[0] = avg_bytes;
+        f[1] = jump_ratio;
+        f[2] = avg_io_bytes;
+        f[3] = seq_ratio;
+        f[4] = iops;
+    }
+};
+
+// ============================================================================
+// EXTRACTOR MULTI-RESOLUCIÓN
+// ============================================================================
+
+/**
+ * Calcula características para varios tamaños de ventana en una sola pasada.
+ *
+ * Los eventos se acumulan en sub-ventanas cuyo tamaño es el MCD de todas las
+ * resoluciones pedidas (p.ej. 50 ms para 100/250/1000/2500/5000 ms). Al
+ * cerrar cada sub-ventana se combina en el acumulador de cada resolución, y
+ * una resolución emite su ventana cuando la sub-ventana siguiente cae fuera
+ * de ella. Las ventanas sin eventos no se emiten.
+ */
+class MultiResolutionExtractor {
+public:
+    // (window_ms, window_index, ts_start_ns, agregado, características)
+    typedef std::function<void(int, uint64_t, uint64_t, const WindowAggregate&, const float*)> Callback;
+
+private:
+    std::vector<int> windows_ms;
+    std::vector<uint64_t> subs_per_window;
+    std::vector<WindowAggregate> acc;
+    uint64_t jump_threshold;
+    uint64_t sub_ns;
+    uint64_t origin_ns;
+    uint64_t cur_sub;
+    bool started;
+    WindowAggregate cur;
+    Callback cb;
+
+    void close_sub(uint64_t next_sub) {
+        for (size_t r = 0; r < windows_ms.size(); r++) {
+            acc[r].merge(cur, jump_threshold);
+            uint64_t k = subs_per_window[r];
+            uint64_t win = cur_sub / k;
+            if (next_sub / k != win) {
+                if (acc[r].reqs > 0 && cb) {
+                    float f[NUM_FEATURES];
+                    acc[r].features((double)windows_ms[r] / 1000.0, f);
+                    cb(windows_ms[r], win, origin_ns + win * k * sub_ns, acc[r], f);
+                }
+                acc[r].reset();
+            }
+        }
+        cur.reset();
+        cur_sub = next_sub;
+    }
+
+public:
+    MultiResolutionExtractor(const std::vector<int>& wins, uint64_t jump_threshold_bytes, Callback callback)
+        : windows_ms(wins), jump_threshold(jump_threshold_bytes), sub_ns(0),
+          origin_ns(0), cur_sub(0), started(false), cb(callback) {
+        int g = 0;
+        for (int w : windows_ms) g = std::gcd(g, w);
+        if (g <= 0) g = 1;
+        sub_ns = (uint64_t)g * 1000000ULL;
+        for (int w : windows_ms) subs_per_window.push_back((uint64_t)(w / g));
+        acc.resize(windows_ms.size());
+    }
+
+    uint64_t sub_window_ms() const { return sub_ns / 1000000ULL; }
+
+    void add(const BlockEvent& e) {
+        // Los eventos muestreados no forman una secuencia completa
+        if (!block_ev_is_data(e.rw) || (e.rw & BLOCK_EV_SAMPLED)) return;
+        if (!started) {
+            origin_ns = e.ts;
+            started = true;
+        }
+        // Los perf buffers por CPU pueden entregar eventos algo desordenados:
+        // los que llegan tarde se cuentan en la sub-ventana actual.
+        uint64_t s = e.ts > origin_ns ? (e.ts - origin_ns) / sub_ns : 0;
+        if (s > cur_sub) close_sub(s);
+        cur.add(e.sector, e.bytes, jump_threshold);
+    }
+
+    // Emite las ventanas parciales pendientes (fin de traza)
+    void flush() {
+        if (!started) return;
+        close_sub(UINT64_MAX);
+        started = false;
+        cur_sub = 0;
+    }
+};
+
+// Parsea una lista "100,250,1000" de tamaños de ventana en ms
+static inline std::vector<int> parse_window_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int v = atoi(item.c_str());
+        if (v > 0) out.push_back(v);
+    }
+    return out;
+}
@@ -0,0 +1,231 @@
+/*
+ * window_trace.h
+ *
+ * Desglose de la latencia de decisión de cada ventana entre el colector y
+ * el daemon.
+ *
+ * Cada ventana lleva un identificador de traza y marcas de CLOCK_MONOTONIC
+ * (el mismo reloj en ambos procesos del host) en cada punto del camino:
+ *
+ *   ingest_close -> features_done -> request_sent -> daemon_received
+ *     -> inference_done -> reply_received -> actuation_done
+ *
+ * Las dos marcas del daemon viajan en la respuesta (PREDICT_REQ_TRACE, ver
+ * predictor_protocol.h). Una etapa es el intervalo entre una marca y la
+ * anterior presente: sin daemon (heurística, backoff) la actuación se mide
+ * desde features_done. StageHistograms agrega cada etapa en un histograma
+ * logarítmico y ChromeTraceWriter vuelca las ventanas en el formato JSON de
+ * trazas de Chrome (chrome://tracing, ui.perfetto.dev).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "predictor_protocol.h"
+
+#define TRACE_HIST_SUB 4          // cubos por potencia de 2
+#define TRACE_HIST_BUCKETS (40 * TRACE_HIST_SUB)   // hasta 2^40 ns (~18 min)
+
+enum TracePoint {
+    TP_INGEST_CLOSE = 0,
+    TP_FEATURES_DONE,
+    TP_REQUEST_SENT,
+    TP_DAEMON_RECEIVED,
+    TP_INFERENCE_DONE,
+    TP_REPLY_RECEIVED,
+    TP_ACTUATION_DONE,
+    TP_COUNT
+};
+
+// Etapa que termina en cada marca (la 0 no cierra ninguna) y la total
+#define TRACE_STAGES TP_COUNT
+#define TRACE_STAGE_TOTAL 0
+static const char* const TRACE_STAGE_NAMES[TRACE_STAGES] = {
+    "total", "features", "send", "ipc_request", "inference", "ipc_reply", "actuation"};
+
+struct WindowTrace {
+    uint64_t id;
+    uint64_t window;
+    uint32_t device_id;
+    uint64_t ts[TP_COUNT];     // 0 = la ventana no pasó por ese punto
+
+    WindowTrace() : id(0), window(0), device_id(0), ts() {}
+
+    void mark(int point) { ts[point] = predict_monotonic_ns(); }
+
+    // Marca anterior presente a point, o -1
+    int previous(int point) const {
+        for (int p = point - 1; p >= 0; p--)
+            if (ts[p]) return p;
+        return -1;
+    }
+
+    // Duración de la etapa que termina en point (TRACE_STAGE_TOTAL: todo); 0 si no hubo
+    uint64_t stage_ns(int stage) const {
+        if (stage == TRACE_STAGE_TOTAL) {
+            int last = previous(TP_COUNT);
+            return last > TP_INGEST_CLOSE && ts[TP_INGEST_CLOSE] ? ts[last] - ts[TP_INGEST_CLOSE] : 0;
+        }
+        int p = previous(stage);
+        if (!ts[stage] || p < 0 || ts[stage] < ts[p]) return 0;
+        return ts[stage] - ts[p];
+    }
+};
+
+/**
+ * Histograma de latencias con TRACE_HIST_SUB cubos por potencia de 2 (error
+ * relativo < 19%); los percentiles interpolan dentro del cubo.
+ */
+class LatencyHistogram {
+private:
+    uint64_t counts[TRACE_HIST_BUCKETS];
+    uint64_t n;
+    uint64_t max_ns;
+    double sum_ns;
+
+    static double bucket_low(int b) {
+        return std::pow(2.0, (double)b / TRACE_HIST_SUB);
+    }
+
+public:
+    LatencyHistogram() : counts(), n(0), max_ns(0), sum_ns(0.0) {}
+
+    void add(uint64_t ns) {
+        int b = ns > 1 ? (int)(std::log2((double)ns) * TRACE_HIST_SUB) : 0;
+        if (b >= TRACE_HIST_BUCKETS) b = TRACE_HIST_BUCKETS - 1;
+        counts[b]++;
+        n++;
+        sum_ns += (double)ns;
+        if (ns > max_ns) max_ns = ns;
+    }
+
+    uint64_t count() const { return n; }
+    double mean_ns() const { return n ? sum_ns / n : 0.0; }
+    uint64_t max() const { return max_ns; }
+
+    double percentile_ns(double p) const {
+        if (n == 0) return 0.0;
+        double target = p * n;
+        double seen = 0.0;
+        for (int b = 0; b < TRACE_HIST_BUCKETS; b++) {
+            if (!counts[b]) continue;
+            if (seen + counts[b] >= target) {
+                double lo = bucket_low(b), hi = bucket_low(b + 1);
+                double v = lo + (hi - lo) * (target - seen) / counts[b];
+                return std::min(v, (double)max_ns);
+            }
+            seen += counts[b];
+        }
+        return (double)max_ns;
+    }
+};
+
+struct StageHistograms {
+    LatencyHistogram stages[TRACE_STAGES];
+
+    void add(const WindowTrace& t) {
+        for (int s = 0; s < TRACE_STAGES; s++) {
+            uint64_t ns = t.stage_ns(s);
+            if (ns) stages[s].add(ns);
+        }
+    }
+
+    // "features p50=12.3us p99=40.1us max=52.0us (n=100), ..." en µs
+    std::string summary() const {
+        std::ostringstream oss;
+        oss.setf(std::ios::fixed);
+        oss.precision(1);
+        bool first = true;
+        for (int s = 1; s <= TRACE_STAGES; s++) {
+            int i = s % TRACE_STAGES;      // total al final
+            const LatencyHistogram& h = stages[i];
+            if (!h.count()) continue;
+            oss << (first ? "" : ", ") << TRACE_STAGE_NAMES[i]
+                << " p50=" << h.percentile_ns(0.50) / 1e3 << "us"
+                << " p99=" << h.percentile_ns(0.99) / 1e3 << "us"
+                << " max=" << h.max() / 1e3 << "us"
+                << " (n=" << h.count() << ")";
+            first = false;
+        }
+        return oss.str();
+    }
+
+    // {"features":{"n":..,"mean_us":..,"p50_us":..,"p99_us":..,"max_us":..},...}
+    std::string json() const {
+        std::ostringstream js;
+        js << "{";
+        bool first = true;
+        for (int s = 0; s < TRACE_STAGES; s++) {
+            const LatencyHistogram& h = stages[s];
+            if (!h.count()) continue;
+            js << (first ? "" : ",") << "\"" << TRACE_STAGE_NAMES[s] << "\":{\"n\":" << h.count()
+               << ",\"mean_us\":" << h.mean_ns() / 1e3
+               << ",\"p50_us\":" << h.percentile_ns(0.50) / 1e3
+               << ",\"p99_us\":" << h.percentile_ns(0.99) / 1e3
+               << ",\"max_us\":" << h.max() / 1e3 << "}";
+            first = false;
+        }
+        js << "}";
+        return js.str();
+    }
+};
+
+/**
+ * Trazas en el "JSON Array Format" de Chrome: un evento completo ("ph":"X")
+ * por etapa, el colector como pid 1 y el daemon como pid 2, un hilo por
+ * dispositivo. El formato tolera que falte el "]" final si el proceso muere.
+ */
+class ChromeTraceWriter {
+private:
+    FILE* fp;
+    bool first;
+
+    void event(const char* name, int pid, const WindowTrace& t, uint64_t start, uint64_t end) {
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"window\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"window\":%llu,\"trace_id\":\"%016llx\"}}",
+                first ? "" : ",", name, pid, t.device_id, start / 1e3, (end - start) / 1e3,
+                (unsigned long long)t.window, (unsigned long long)t.id);
+        first = false;
+    }
+
+    void process_name(int pid, const char* name) {
+        fprintf(fp, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",", pid, name);
+        first = false;
+    }
+
+public:
+    ChromeTraceWriter() : fp(nullptr), first(true) {}
+
+    ~ChromeTraceWriter() {
+        if (fp) {
+            fputs("\n]\n", fp);
+            fclose(fp);
+        }
+    }
+
+    bool open(const std::string& path) {
+        fp = fopen(path.c_str(), "w");
+        if (!fp) return false;
+        fputs("[", fp);
+        process_name(1, "ebpf_block_trace");
+        process_name(2, "ml_predictor");
+        return true;
+    }
+
+    void write(const WindowTrace& t) {
+        if (!fp) return;
+        for (int s = 1; s < TRACE_STAGES; s++) {
+            if (!t.stage_ns(s)) continue;
+            bool daemon = (s == TP_INFERENCE_DONE);
+            event(TRACE_STAGE_NAMES[s], daemon ? 2 : 1, t, t.ts[t.previous(s)], t.ts[s]);
+        }
+        fflush(fp);
+    }
+};
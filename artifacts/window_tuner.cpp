@@ -0,0 +1,381 @@
+/*
+ * window_tuner.cpp
+ *
+ * Ajuste automático del tamaño de ventana y del umbral de salto.
+ *
+ * Re-procesa grabaciones etiquetadas (ebpf_block_trace --record) con el
+ * extractor multi-resolución: una sola lectura de los eventos alimenta un
+ * extractor por umbral, y cada extractor calcula todas las ventanas a la vez.
+ * Cada ventana se clasifica con el daemon ml_predictor en ejecución y se
+ * mide accuracy, latencia de decisión y coste de CPU por combinación.
+ *
+ * Se elige la ventana más pequeña que mantiene la accuracy objetivo y se
+ * escribe en la configuración del colector para la clase de dispositivo.
+ *
+ * Uso:
+ *   ./window_tuner --trace seq.bin:sequential --trace rand.bin:random \
+ *                  --trace mix.bin:mixed --device-class ssd \
+ *                  --target-accuracy 0.9 --config /etc/ebpf_block_trace.conf
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <getopt.h>
+
+#include "window_features.h"
+#include "predictor_client.h"
+#include "collector_config.h"
+
+// ============================================================================
+// CONFIG
+// ============================================================================
+
+#define DEFAULT_SOCK_PATH "/tmp/ml_predictor.sock"
+#define DEFAULT_WINDOWS "100,250,500,1000,2500,5000"
+#define DEFAULT_THRESHOLDS "262144,524288,1000000,2000000,4000000"
+#define DEFAULT_TARGET_ACCURACY 0.90
+
+static const char* CLASS_NAMES[3] = {"sequential", "random", "mixed"};
+
+static int label_to_class(const std::string& label) {
+    for (int i = 0; i < 3; i++)
+        if (label == CLASS_NAMES[i]) return i;
+    return -1;
+}
+
+/**
+ * Lista "262144,1000000" de umbrales en bytes. A diferencia de
+ * parse_window_list() no pasa por int: rechaza con err valores no
+ * numéricos, nulos o que no caben en 64 bits.
+ */
+static bool parse_threshold_list(const std::string& s, std::vector<uint64_t>* out,
+                                 std::string* err) {
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const char* str = item.c_str();
+        while (*str == ' ' || *str == '\t') str++;
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long v = *str == '-' ? 0 : strtoull(str, &end, 10);
+        if (*str == '-' || end == str || *end != '\0' || errno == ERANGE || v == 0) {
+            *err = "invalid threshold '" + item + "'";
+            return false;
+        }
+        out->push_back((uint64_t)v);
+    }
+    return true;
+}
+
+static uint64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// RESULTADOS
+// ============================================================================
+
+struct LabelledTrace {
+    std::string path;
+    int label;
+};
+
+struct WindowRow {
+    float f[NUM_FEATURES];
+    int label;
+};
+
+struct TuneResult {
+    int window_ms;
+    uint64_t threshold;
+    uint64_t windows;
+    uint64_t correct;
+    uint64_t errors;
+    double accuracy;
+    double decision_latency_ms;   // ventana + ida y vuelta al daemon
+    double cpu_us_per_s;          // CPU del colector por segundo de traza
+};
+
+// ============================================================================
+// TUNER
+// ============================================================================
+
+class WindowTuner {
+private:
+    std::vector<int> windows_ms;
+    std::vector<uint64_t> thresholds;
+    std::string sock_path;
+
+    // rows[threshold_idx][window_ms] -> ventanas extraídas
+    std::vector<std::map<int, std::vector<WindowRow>>> rows;
+    std::vector<uint64_t> agg_cpu_ns;    // CPU de agregación por umbral
+    uint64_t total_events;
+    double total_trace_s;
+
+    bool scan_trace(const LabelledTrace& t) {
+        FILE* in = fopen(t.path.c_str(), "rb");
+        if (!in || !read_event_file_header(in)) {
+            std::cerr << "ERROR: Cannot read event recording " << t.path << "\n";
+            if (in) fclose(in);
+            return false;
+        }
+
+        std::vector<MultiResolutionExtractor> extractors;
+        for (size_t ti = 0; ti < thresholds.size(); ti++) {
+            auto* dst = &rows[ti];
+            int label = t.label;
+            extractors.emplace_back(windows_ms, thresholds[ti],
+                [dst, label](int wms, uint64_t, uint64_t, const WindowAggregate&, const float* f) {
+                    WindowRow r;
+                    memcpy(r.f, f, sizeof(r.f));
+                    r.label = label;
+                    (*dst)[wms].push_back(r);
+                });
+        }
+
+        // Una sola lectura: cada bloque de eventos alimenta todos los extractores
+        std::vector<BlockEvent> buf(65536);
+        uint64_t first_ts = 0, last_ts = 0, n_events = 0;
+        size_t n;
+        while ((n = fread(buf.data(), sizeof(BlockEvent), buf.size(), in)) > 0) {
+            if (n_events == 0) first_ts = buf[0].ts;
+            last_ts = buf[n - 1].ts;
+            n_events += n;
+            for (size_t ti = 0; ti < extractors.size(); ti++) {
+                uint64_t c0 = thread_cpu_ns();
+                for (size_t i = 0; i < n; i++) extractors[ti].add(buf[i]);
+                agg_cpu_ns[ti] += thread_cpu_ns() - c0;
+            }
+        }
+        for (auto& e : extractors) e.flush();
+        fclose(in);
+
+        total_events += n_events;
+        if (last_ts > first_ts) total_trace_s += (double)(last_ts - first_ts) / 1e9;
+        std::cerr << "  " << t.path << ": " << n_events << " events ("
+                  << CLASS_NAMES[t.label] << ")\n";
+        return true;
+    }
+
+public:
+    WindowTuner(const std::vector<int>& wins, const std::vector<uint64_t>& thrs,
+                const std::string& sock)
+        : windows_ms(wins), thresholds(thrs), sock_path(sock),
+          rows(thrs.size()), agg_cpu_ns(thrs.size(), 0),
+          total_events(0), total_trace_s(0.0) {}
+
+    bool scan(const std::vector<LabelledTrace>& traces) {
+        for (const auto& t : traces)
+            if (!scan_trace(t)) return false;
+        return total_events > 0;
+    }
+
+    std::vector<TuneResult> evaluate() {
+        std::vector<TuneResult> results;
+        for (size_t ti = 0; ti < thresholds.size(); ti++) {
+            double agg_ns_per_event = total_events ? (double)agg_cpu_ns[ti] / total_events : 0.0;
+            double events_per_s = total_trace_s > 0 ? total_events / total_trace_s : 0.0;
+
+            for (int wms : windows_ms) {
+                TuneResult r = {};
+                r.window_ms = wms;
+                r.threshold = thresholds[ti];
+                double rtt_ns_sum = 0.0;
+
+                for (const WindowRow& row : rows[ti][wms]) {
+                    auto t0 = std::chrono::steady_clock::now();
+                    int pred = predictor_request(sock_path, row.f);
+                    auto t1 = std::chrono::steady_clock::now();
+                    if (pred < 0) {
+                        r.errors++;
+                        continue;
+                    }
+                    rtt_ns_sum += std::chrono::duration<double, std::nano>(t1 - t0).count();
+                    r.windows++;
+                    if (pred == row.label) r.correct++;
+                }
+
+                double rtt_ns = r.windows ? rtt_ns_sum / r.windows : 0.0;
+                r.accuracy = r.windows ? (double)r.correct / r.windows : 0.0;
+                r.decision_latency_ms = wms + rtt_ns / 1e6;
+                // Agregar eventos es independiente de la ventana; lo que crece
+                // con ventanas pequeñas es el número de decisiones por segundo.
+                r.cpu_us_per_s = (agg_ns_per_event * events_per_s +
+                                  (1000.0 / wms) * rtt_ns) / 1000.0;
+                results.push_back(r);
+            }
+        }
+        return results;
+    }
+
+    /**
+     * Elige la ventana más pequeña con accuracy >= objetivo. Entre umbrales
+     * con la misma ventana gana el de mayor accuracy. Si ninguna combinación
+     * alcanza el objetivo se devuelve la de mayor accuracy.
+     */
+    static const TuneResult* choose(const std::vector<TuneResult>& results, double target) {
+        const TuneResult* best = nullptr;
+        for (const auto& r : results) {
+            if (r.windows == 0 || r.accuracy < target) continue;
+            if (!best || r.window_ms < best->window_ms ||
+                (r.window_ms == best->window_ms && r.accuracy > best->accuracy))
+                best = &r;
+        }
+        if (best) return best;
+        for (const auto& r : results)
+            if (r.windows > 0 && (!best || r.accuracy > best->accuracy)) best = &r;
+        return best;
+    }
+};
+
+static void print_results(const std::vector<TuneResult>& results, std::ostream& os, bool csv) {
+    if (csv) {
+        os << "window_ms,jump_threshold_bytes,windows,errors,accuracy,decision_latency_ms,cpu_us_per_s\n";
+        for (const auto& r : results)
+            os << r.window_ms << "," << r.threshold << "," << r.windows << "," << r.errors << ","
+               << r.accuracy << "," << r.decision_latency_ms << "," << r.cpu_us_per_s << "\n";
+        return;
+    }
+    os << std::fixed << std::setprecision(4);
+    os << std::setw(10) << "window_ms" << std::setw(12) << "threshold" << std::setw(9) << "windows"
+       << std::setw(10) << "accuracy" << std::setw(14) << "latency_ms" << std::setw(14) << "cpu_us/s"
+       << "\n";
+    for (const auto& r : results)
+        os << std::setw(10) << r.window_ms << std::setw(12) << r.threshold << std::setw(9) << r.windows
+           << std::setw(10) << r.accuracy << std::setw(14) << r.decision_latency_ms
+           << std::setw(14) << r.cpu_us_per_s << "\n";
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::vector<LabelledTrace> traces;
+    std::string sock = DEFAULT_SOCK_PATH;
+    std::vector<int> windows = parse_window_list(DEFAULT_WINDOWS);
+    std::string thresholds_str = DEFAULT_THRESHOLDS;
+    double target = DEFAULT_TARGET_ACCURACY;
+    std::string device_class;
+    std::string config_path;
+    std::string report_path;
+
+    static struct option long_opts[] = {
+        {"trace", required_argument, 0, 't'},
+        {"windows", required_argument, 0, 'w'},
+        {"thresholds", required_argument, 0, 'j'},
+        {"target-accuracy", required_argument, 0, 'a'},
+        {"sock", required_argument, 0, 's'},
+        {"device-class", required_argument, 0, 'd'},
+        {"config", required_argument, 0, 'c'},
+        {"report", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0,0,0,0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:w:j:a:s:d:c:r:h", long_opts, nullptr)) != -1) {
+        if (opt == 't') {
+            std::string arg = optarg;
+            size_t colon = arg.rfind(':');
+            int label = colon == std::string::npos ? -1 : label_to_class(arg.substr(colon + 1));
+            if (label < 0) {
+                std::cerr << "ERROR: --trace expects <recording>:<sequential|random|mixed>\n";
+                return 1;
+            }
+            traces.push_back({arg.substr(0, colon), label});
+        }
+        else if (opt == 'w') windows = parse_window_list(optarg);
+        else if (opt == 'j') thresholds_str = optarg;
+        else if (opt == 'a') target = atof(optarg);
+        else if (opt == 's') sock = optarg;
+        else if (opt == 'd') device_class = optarg;
+        else if (opt == 'c') config_path = optarg;
+        else if (opt == 'r') report_path = optarg;
+        else if (opt == 'h') {
+            std::cout << "Usage: " << argv[0] << " --trace <rec>:<label> [...] [options]\n"
+                      << "  -t, --trace <file>:<label>     Recording from ebpf_block_trace --record\n"
+                      << "  -w, --windows <list>           Window sizes in ms (default: " DEFAULT_WINDOWS ")\n"
+                      << "  -j, --thresholds <list>        Jump thresholds in bytes\n"
+                      << "                                 (default: " DEFAULT_THRESHOLDS ")\n"
+                      << "  -a, --target-accuracy <x>      Minimum accuracy (default: 0.90)\n"
+                      << "  -s, --sock <path>              Predictor socket (default: /tmp/ml_predictor.sock)\n"
+                      << "  -d, --device-class <class>     hdd, ssd or nvme (needed with --config)\n"
+                      << "  -c, --config <file>            Collector config to update with the choice\n"
+                      << "  -r, --report <csv>             Write the full tradeoff table as CSV\n"
+                      << "  -h, --help                     Show this help\n";
+            return 0;
+        }
+    }
+
+    std::vector<uint64_t> thresholds;
+    std::string err;
+    if (!parse_threshold_list(thresholds_str, &thresholds, &err)) {
+        std::cerr << "ERROR: --thresholds: " << err << "\n";
+        return 1;
+    }
+
+    if (traces.empty() || windows.empty() || thresholds.empty()) {
+        std::cerr << "ERROR: need at least one --trace, window and threshold (see --help)\n";
+        return 1;
+    }
+    if (!config_path.empty() && device_class.empty()) {
+        std::cerr << "ERROR: --config requires --device-class\n";
+        return 1;
+    }
+
+    std::cerr << "Scanning " << traces.size() << " recordings ("
+              << windows.size() << " windows x " << thresholds.size() << " thresholds)...\n";
+
+    WindowTuner tuner(windows, thresholds, sock);
+    if (!tuner.scan(traces)) {
+        std::cerr << "ERROR: no events to evaluate\n";
+        return 1;
+    }
+
+    std::vector<TuneResult> results = tuner.evaluate();
+    print_results(results, std::cout, false);
+
+    if (!report_path.empty()) {
+        std::ofstream rep(report_path);
+        print_results(results, rep, true);
+    }
+
+    const TuneResult* best = WindowTuner::choose(results, target);
+    if (!best) {
+        std::cerr << "ERROR: no window could be classified (is ml_predictor running?)\n";
+        return 1;
+    }
+    if (best->accuracy < target) {
+        std::cerr << "WARNING: no combination reaches accuracy " << target
+                  << "; using the most accurate one\n";
+    }
+    std::cout << "\nChosen: window_ms=" << best->window_ms
+              << " jump_threshold_bytes=" << best->threshold
+              << " accuracy=" << best->accuracy << "\n";
+
+    if (!config_path.empty()) {
+        CollectorConfig config;
+        config.load(config_path);
+        config.set(device_class, "window_ms", std::to_string(best->window_ms));
+        config.set(device_class, "jump_threshold_bytes", std::to_string(best->threshold));
+        if (!config.save(config_path, "ebpf_block_trace parameters (updated by window_tuner)")) {
+            std::cerr << "ERROR: cannot write " << config_path << "\n";
+            return 1;
+        }
+        std::cout << "Updated [" << device_class << "] in " << config_path << "\n";
+    }
+
+    return 0;
+}
@@ -12,7 +12,17 @@ MODE="$1"   # baseline o ml
 REPEAT=3                          # repeticiones por configuración
 FILESIZES=("100M" "500M" "1G")    # tamaños de archivo
 ACCESS_TYPES=("seq" "rand" "mix") # tipos de acceso
-BASE_DIR="./results_${MODE}"      # carpeta raíz depende del modo
+DIRECT="${DIRECT:-0}"             # 1 = O_DIRECT (sin caché de páginas: el readahead no influye)
+ENGINE="${ENGINE:-fio}"           # fio o io_workload (generador io_uring de artifacts/)
+IO_WORKLOAD="${IO_WORKLOAD:-../artifacts/io_workload}"
+
+# Con direct I/O el readahead no tiene efecto; esos resultados (los históricos)
+# quedan en results_<modo> y los de I/O con caché en results_<modo>_buffered
+if [ "$DIRECT" = "1" ]; then
+    BASE_DIR="./results_${MODE}"
+else
+    BASE_DIR="./results_${MODE}_buffered"
+fi
 DEVICE="./testfile"               # archivo sobre el cual leerá fio
 
 mkdir -p "$BASE_DIR"
@@ -44,7 +54,8 @@ run_fio() {
             --bs=128k \
             --numjobs=1 \
             --iodepth=1 \
-            --direct=1 \
+            --direct=$DIRECT \
+            --invalidate=1 \
             --time_based \
             --runtime=10 \
             --output-format=json \
@@ -53,11 +64,41 @@ run_fio() {
 }
 
 
+# ===============================
+# FUNCIÓN PARA EJECUTAR IO_WORKLOAD
+# ===============================
+# Mismos parámetros que run_fio; además de un resumen por fase deja una
+# línea de tiempo con marcas de CLOCK_MONOTONIC y la etiqueta de la fase
+run_io_workload() {
+    local access=$1
+    local size=$2
+    local outdir=$3
+
+    mkdir -p "$outdir"
+
+    local flags=""
+    [ "$DIRECT" = "1" ] && flags="--direct"
+
+    for (( r=1; r<=REPEAT; r++ )); do
+        case $access in
+            seq)  PHASE="seq:10:bs=128k,qd=1" ;;
+            rand) PHASE="rand:10:bs=128k,qd=1" ;;
+            mix)  PHASE="rand:10:bs=128k,qd=1,read=50,label=mixed" ;;   # como fio randrw
+        esac
+
+        "$IO_WORKLOAD" --target "$DEVICE" --size "$size" $flags \
+            --phase "$PHASE" --seed "$r" \
+            --timeline "${outdir}/timeline_${size}_run${r}.csv" \
+            2> "${outdir}/result_${size}_run${r}.txt"
+    done
+}
+
+
 # ===============================
 # EJECUCIÓN DEL EXPERIMENTO
 # ===============================
 
-echo "=== MODO: $MODE ==="
+echo "=== MODO: $MODE (direct=$DIRECT, engine=$ENGINE) ==="
 echo "Resultados en: $BASE_DIR"
 
 for SIZE in "${FILESIZES[@]}"; do
@@ -66,7 +107,11 @@ for SIZE in "${FILESIZES[@]}"; do
         OUTDIR="${BASE_DIR}/${ACCESS}/${SIZE}"
 
         echo "=== Ejecutando $MODE | ACCESS=$ACCESS | SIZE=$SIZE ==="
-        run_fio "$ACCESS" "$SIZE" "$OUTDIR"
+        if [ "$ENGINE" = "io_workload" ]; then
+            run_io_workload "$ACCESS" "$SIZE" "$OUTDIR"
+        else
+            run_fio "$ACCESS" "$SIZE" "$OUTDIR"
+        fi
 
     done
 done
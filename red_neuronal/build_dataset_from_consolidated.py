@@ -14,6 +14,14 @@ import pandas as pd
 from sklearn.model_selection import train_test_split
 from sklearn.preprocessing import StandardScaler
 
+from bundle import update_bundle
+
+# Cuantiles de la referencia de drift (ver artifacts/drift_monitor.h)
+DRIFT_QUANTILES = np.linspace(0.0, 1.0, 11)
+
+# Mismo orden que FEATURE_NAMES en artifacts/window_features.h
+FEATURE_NAMES = ["avg_distance_bytes", "jump_ratio", "avg_io_bytes", "seq_ratio", "iops"]
+
 
 def map_label_to_int(label: str) -> int:
     """Mapea etiquetas de texto a enteros."""
@@ -79,6 +87,36 @@ def extract_features_from_consolidated(df: pd.DataFrame) -> np.ndarray:
     return np.asarray(features, dtype=np.float32)
 
 
+def _fmt(values) -> str:
+    return ",".join(f"{float(v):.9g}" for v in values)
+
+
+def model_features(stds: np.ndarray) -> str:
+    """
+    Características que usa el modelo (clave "features" del bundle, ver
+    artifacts/feature_plan.h): las constantes en entrenamiento se normalizan
+    a 0 y no aportan nada, así que el colector no tiene que calcularlas.
+    """
+    return ",".join(name for name, std in zip(FEATURE_NAMES, stds) if std > 1e-4)
+
+
+def drift_reference(X_raw: np.ndarray) -> dict:
+    """
+    Referencia de drift por característica sobre los valores SIN normalizar:
+    cuantiles sin repetidos (drift_edges_i) y fracción de muestras en cada
+    bin de np.searchsorted(edges, x, side="left") (drift_ref_i, len+1 bins).
+    """
+    entries = {}
+    for i in range(X_raw.shape[1]):
+        col = X_raw[:, i].astype(np.float64)
+        edges = np.unique(np.quantile(col, DRIFT_QUANTILES))
+        bins = np.searchsorted(edges, col, side="left")
+        ref = np.bincount(bins, minlength=len(edges) + 1) / len(col)
+        entries[f"drift_edges_{i}"] = _fmt(edges)
+        entries[f"drift_ref_{i}"] = _fmt(ref)
+    return entries
+
+
 def main() -> None:
     consolidated_csv = Path("consolidated_dataset.csv")
     if not consolidated_csv.exists():
@@ -123,6 +161,7 @@ def main() -> None:
     # Normalizar
     print("Normalizando características...")
     scaler = StandardScaler()
+    X_train_raw = X_train
     X_train = scaler.fit_transform(X_train).astype(np.float32)
     X_test = scaler.transform(X_test).astype(np.float32)
     
@@ -140,6 +179,21 @@ def main() -> None:
     # Guardar scaler
     joblib.dump(scaler, artifacts_dir / "scaler.pkl")
     print(f"Scaler guardado en {artifacts_dir / 'scaler.pkl'}")
+
+    # Scaler y referencia de drift para el daemon. Se exporta la std real
+    # (0 en características constantes) en lugar de scale_, que sklearn fija
+    # a 1: así el daemon las normaliza a 0, igual que en entrenamiento.
+    # Las trazas consolidadas no separan lecturas y escrituras: el modelo
+    # consume el flujo combinado ("all").
+    update_bundle(
+        artifacts_dir,
+        stream="all",
+        feature_means=_fmt(scaler.mean_),
+        feature_stds=_fmt(np.sqrt(scaler.var_)),
+        features=model_features(np.sqrt(scaler.var_)),
+        **drift_reference(X_train_raw),
+    )
+    print(f"Scaler y referencia de drift registrados en {artifacts_dir / 'bundle.conf'}")
     
     # Guardar metadata
     metadata = {
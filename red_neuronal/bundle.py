@@ -0,0 +1,40 @@
+"""
+Manifiesto del bundle de modelos (artifacts/bundle.conf).
+
+Archivo "clave = valor" que lee el daemon ml_predictor (ver
+artifacts/model_bundle.h). Cada script de entrenamiento registra aquí sus
+artefactos sin borrar las claves de los demás.
+"""
+
+from pathlib import Path
+from typing import Dict
+
+BUNDLE_NAME = "bundle.conf"
+
+HEADER = "# Bundle de modelos para ml_predictor (generado por red_neuronal/*.py)"
+
+
+def read_bundle(artifacts_dir: Path) -> Dict[str, str]:
+    path = artifacts_dir / BUNDLE_NAME
+    values: Dict[str, str] = {}
+    if not path.exists():
+        return values
+    for line in path.read_text(encoding="utf-8").splitlines():
+        line = line.strip()
+        if not line or line.startswith("#") or "=" not in line:
+            continue
+        key, value = line.split("=", 1)
+        values[key.strip()] = value.strip()
+    return values
+
+
+def update_bundle(artifacts_dir: Path, **entries: str) -> None:
+    """Actualiza (o crea) el manifiesto con las claves dadas."""
+    artifacts_dir.mkdir(parents=True, exist_ok=True)
+    values = read_bundle(artifacts_dir)
+    values.update({k: str(v) for k, v in entries.items()})
+    values.setdefault("backend", "torchscript")
+
+    lines = [HEADER]
+    lines += [f"{k} = {v}" for k, v in values.items()]
+    (artifacts_dir / BUNDLE_NAME).write_text("\n".join(lines) + "\n", encoding="utf-8")
@@ -9,6 +9,7 @@ import torch.optim as optim
 from torch.utils.data import TensorDataset, DataLoader
 
 from neuronal_red import IOPatternClassifier
+from bundle import update_bundle
 
 
 def set_seed(seed: int = 42) -> None:
@@ -139,6 +140,7 @@ def main() -> None:
 
     torch.save(model.state_dict(), artifacts / "model.pth")
     export_model(model, input_size, artifacts)
+    update_bundle(artifacts, torchscript_model="model_ts.pt")
 
     summary = {
         "input_size": input_size,
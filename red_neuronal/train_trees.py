@@ -0,0 +1,164 @@
+"""
+Entrena un ensemble de árboles (gradient boosting o random forest) sobre las
+mismas 5 características normalizadas que la red neuronal y lo exporta al
+formato plano que carga ml_predictor (artifacts/tree_ensemble.h).
+
+Cada árbol se rellena hasta un árbol binario completo de profundidad fija
+para que el daemon lo recorra sin saltos condicionales.
+
+Uso:
+    python train_trees.py                 # gradient boosting
+    python train_trees.py --kind rf       # random forest
+    python train_trees.py --activate      # usar árboles como backend del daemon
+"""
+
+import argparse
+import json
+from pathlib import Path
+from typing import List, Tuple
+
+import numpy as np
+from sklearn.ensemble import GradientBoostingClassifier, RandomForestClassifier
+
+from bundle import update_bundle
+
+TREES_FILE = "model_trees.txt"
+LEAF = -1  # sklearn: children_left == -1 en las hojas
+
+
+def load_data() -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+    train_npz = np.load("data/processed/train.npz")
+    test_npz = np.load("data/processed/test.npz")
+    return train_npz["X"], train_npz["y"], test_npz["X"], test_npz["y"]
+
+
+def flatten_tree(tree, depth: int, leaf_value) -> Tuple[List[Tuple[int, float]], List[np.ndarray]]:
+    """
+    Convierte un árbol de sklearn en un árbol completo de profundidad `depth`
+    en orden de heap. Las hojas que quedan por encima del último nivel se
+    replican con nodos (feature 0, umbral +inf), que siempre van a la izquierda.
+    """
+    n_internal = (1 << depth) - 1
+    internal: List[Tuple[int, float]] = [(0, float("inf"))] * n_internal
+    leaves: List[np.ndarray] = [None] * (1 << depth)
+
+    def fill(node: int, heap: int, level: int) -> None:
+        if level == depth:
+            leaves[heap - n_internal] = leaf_value(node)
+            return
+        left = tree.children_left[node]
+        if left == LEAF:
+            internal[heap] = (0, float("inf"))
+            fill(node, 2 * heap + 1, level + 1)
+            fill(node, 2 * heap + 2, level + 1)
+            return
+        # sklearn va a la izquierda si x <= umbral; el daemon va a la derecha si x > umbral
+        internal[heap] = (int(tree.feature[node]), float(tree.threshold[node]))
+        fill(left, 2 * heap + 1, level + 1)
+        fill(tree.children_right[node], 2 * heap + 2, level + 1)
+
+    fill(0, 0, 0)
+    return internal, leaves
+
+
+def export_ensemble(clf, X_ref: np.ndarray, num_classes: int, path: Path) -> int:
+    """Escribe el ensemble en formato TREE_ENSEMBLE y devuelve la profundidad."""
+    trees = []  # (sklearn tree_, función hoja -> vector por clase)
+
+    if isinstance(clf, GradientBoostingClassifier):
+        lr = clf.learning_rate
+        for stage in clf.estimators_:
+            for k, reg in enumerate(stage):
+                t = reg.tree_
+
+                def leaf_value(node, t=t, k=k):
+                    v = np.zeros(num_classes, dtype=np.float64)
+                    v[k] = lr * t.value[node][0][0]
+                    return v
+
+                trees.append((t, leaf_value))
+        # Puntuación inicial (log-priors): decisión menos la suma de los árboles
+        x0 = X_ref[:1]
+        contrib = np.zeros(num_classes)
+        for stage in clf.estimators_:
+            for k, reg in enumerate(stage):
+                contrib[k] += lr * reg.predict(x0)[0]
+        base = clf.decision_function(x0)[0] - contrib
+    else:
+        n = len(clf.estimators_)
+        for est in clf.estimators_:
+            t = est.tree_
+
+            def leaf_value(node, t=t):
+                v = t.value[node][0].astype(np.float64)
+                return v / max(v.sum(), 1e-12) / n
+
+            trees.append((t, leaf_value))
+        base = np.zeros(num_classes)
+
+    depth = max(t.max_depth for t, _ in trees)
+    depth = max(depth, 1)
+
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("TREE_ENSEMBLE 1\n")
+        f.write(f"num_features {X_ref.shape[1]}\n")
+        f.write(f"num_classes {num_classes}\n")
+        f.write(f"num_trees {len(trees)}\n")
+        f.write(f"depth {depth}\n")
+        f.write("base " + " ".join(f"{b:.9g}" for b in base) + "\n")
+        for t, leaf_value in trees:
+            internal, leaves = flatten_tree(t, depth, leaf_value)
+            f.write("tree\n")
+            for feat, thr in internal:
+                f.write(f"{feat} {'inf' if np.isinf(thr) else format(thr, '.9g')}\n")
+            for v in leaves:
+                f.write(" ".join(f"{x:.9g}" for x in v) + "\n")
+
+    return depth
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Entrena y exporta un ensemble de árboles")
+    parser.add_argument("--kind", choices=["gb", "rf"], default="gb")
+    parser.add_argument("--n-estimators", type=int, default=50)
+    parser.add_argument("--max-depth", type=int, default=3)
+    parser.add_argument("--activate", action="store_true",
+                        help="Selecciona los árboles como backend en bundle.conf")
+    args = parser.parse_args()
+
+    X_train, y_train, X_test, y_test = load_data()
+    num_classes = int(len(np.unique(y_train)))
+
+    if args.kind == "gb":
+        clf = GradientBoostingClassifier(
+            n_estimators=args.n_estimators, max_depth=args.max_depth, random_state=42
+        )
+    else:
+        clf = RandomForestClassifier(
+            n_estimators=args.n_estimators, max_depth=args.max_depth, random_state=42
+        )
+    clf.fit(X_train, y_train)
+    acc = float((clf.predict(X_test) == y_test).mean())
+
+    artifacts = Path("artifacts")
+    artifacts.mkdir(exist_ok=True, parents=True)
+    depth = export_ensemble(clf, X_train, num_classes, artifacts / TREES_FILE)
+
+    entries = {"trees_model": TREES_FILE}
+    if args.activate:
+        entries["backend"] = "trees"
+    update_bundle(artifacts, **entries)
+
+    summary = {
+        "kind": args.kind,
+        "n_estimators": args.n_estimators,
+        "depth": depth,
+        "test_accuracy": acc,
+    }
+    (artifacts / "trees_summary.json").write_text(json.dumps(summary, indent=2), encoding="utf-8")
+
+    print(f"Ensemble {args.kind} exportado (profundidad {depth}). Accuracy test={acc:.4f}.")
+
+
+if __name__ == "__main__":
+    main()